@@ -0,0 +1,63 @@
+#ifndef BOT_REGISTRY_H
+#define BOT_REGISTRY_H
+
+#include <vector>
+#include <unordered_map>
+#include <cassert>
+#include "../../api/GameInfo.h"
+
+using namespace std;
+
+typedef unsigned BotId;
+
+/**
+* Id of bots the registry does not know.
+*/
+const BotId NO_BOT = ~0u;
+
+/**
+* Interns every bot of a match, both teams, to a dense id in [0, size()).
+* Per-bot state can then live in flat arrays indexed by id instead of maps keyed by name.
+* Ids follow the name order of GameInfo::bots, so they are the same for every run of a match.
+*/
+class BotRegistry
+{
+private:
+	vector<const BotInfo*> m_Bots;
+	vector<char> m_OwnTeam;
+	unordered_map<const BotInfo*, BotId> m_Ids;
+
+public:
+	void init(const GameInfo& gameInfo)
+	{
+		m_Bots.clear();
+		m_OwnTeam.clear();
+		m_Ids.clear();
+
+		for (auto iter = gameInfo.bots.begin(); iter != gameInfo.bots.end(); ++iter)
+		{
+			const BotInfo* bot = iter->second.get();
+			m_Ids[bot] = m_Bots.size();
+			m_Bots.push_back(bot);
+			m_OwnTeam.push_back(bot->team == gameInfo.team);
+		}
+	}
+
+	size_t size() const { return m_Bots.size(); }
+
+	BotId getId(const BotInfo& bot) const
+	{
+		auto found = m_Ids.find(&bot);
+		return found != m_Ids.end() ? found->second : NO_BOT;
+	}
+
+	const BotInfo& getBot(BotId id) const
+	{
+		assert(id < m_Bots.size());
+		return *m_Bots[id];
+	}
+
+	bool isOwnTeam(BotId id) const { return m_OwnTeam[id] != 0; }
+};
+
+#endif // !defined (BOT_REGISTRY_H)
@@ -3,40 +3,58 @@
 
 #include "../../api/GameInfo.h"
 #include "DecisionMaking.h"
+#include "tools/Random.h"
+#include "CommandPool.hpp"
+#include "WorldSnapshot.hpp"
+#include "SpatialGrid.hpp"
 
 using namespace dms;
 
 class AttackerDMS : public DecisionMaking
 {
 private:
-	const BotInfo* m_Bot;
-	GameInfo* m_GameInfo;
-	LevelInfo *m_LevelInfo;
+	BotId m_Bot;
+
+	/**
+	* Random stream of this bot only, so bots can be ticked concurrently and replayed.
+	*/
+	Random m_Random;
+
+	/**
+	* Free cells of the level the random targets are drawn from.
+	*/
+	const SpatialGrid* m_Grid;
+
+	/**
+	* Pool the commands are taken from and the slot of this bot in it.
+	*/
+	CommandPool* m_CommandPool;
+	size_t m_Slot;
 public:
-	AttackerDMS(const BotInfo& bot, GameInfo& gameInfo, LevelInfo& levelInfo)
-		: m_Bot(&bot), m_GameInfo(&gameInfo), m_LevelInfo(&levelInfo) {}
+	AttackerDMS(BotId bot, const Random& random, const SpatialGrid& grid, CommandPool& commandPool, size_t slot)
+		: m_Bot(bot), m_Random(random), m_Grid(&grid), m_CommandPool(&commandPool), m_Slot(slot) {}
 
-	virtual const Command* tick()
+	virtual const Command* tick(const WorldSnapshot& world)
 	{
 		// Determine a place to run randomly...
 		Vector2 target;
-		switch((int)((float)rand()/RAND_MAX*3))
+		switch(m_Random.nextInt(3))
 		{
 		case 0: // Either a random choice of *current* flag locations, ours or theirs.
-			target = (((float)rand()/RAND_MAX > 0.5f) ? m_GameInfo->team : m_GameInfo->enemyTeam)->flag->position;
+			target = m_Random.nextBool() ? world.getOwnFlag() : world.getEnemyFlag();
 			break;
 
 		case 1: // Or a random choice of the goal locations for returning flags.
-			target = (((float)rand()/RAND_MAX > 0.5f) ? m_GameInfo->team : m_GameInfo->enemyTeam)->flagScoreLocation;
+			target = m_Random.nextBool() ? world.getOwnScoreLocation() : world.getEnemyScoreLocation();
 			break; 
 
 		case 2: // Or a random position in the entire level, one that's not blocked.
-			target = *m_Bot->position;
-			m_LevelInfo->findRandomFreePositionInBox(target, Vector2(0.0f,0.0f), Vector2((float)m_LevelInfo->width, (float)m_LevelInfo->height));
+			target = world.getPosition(m_Bot);
+			m_Grid->findRandomFreePosition(m_Random, target);
 			break;
 		}
 
-		return new AttackCommand(m_Bot->name, target, boost::none, "AttackerDMS: random attack");
+		return m_CommandPool->attack(m_Slot, world.getName(m_Bot), target, boost::none, "AttackerDMS: random attack");
 	}
 };
 
@@ -0,0 +1,256 @@
+#ifndef COMMAND_BATCH_H
+#define COMMAND_BATCH_H
+
+#include <vector>
+#include <string>
+#include <cassert>
+#include <boost/cstdint.hpp>
+#include <boost/optional.hpp>
+#include "../../api/Vector2.h"
+#include "../../api/Commands.h"
+#include "BotRegistry.hpp"
+
+using namespace std;
+
+/**
+* One command as it is read back from a batch.
+*/
+struct BatchedCommand
+{
+	int m_Kind;
+	BotId m_BotId;
+	Vector2 m_Target;
+	boost::optional<Vector2> m_LookAt;
+	string m_Description;
+};
+
+/**
+* All commands of one tick in a compact binary form, flushed in one go.
+* Bots are identified by their id of the BotRegistry, positions are quantized
+* to 1/POSITION_SCALE of a level unit, descriptions are only written when enabled.
+*
+* Every command is a record of
+*   uint8   kind, ORed with the flags of the optional parts
+*   uint16  bot id
+*   int16   target x, y
+*   int16   look at x, y         (FLAG_LOOK_AT only)
+*   uint8   length, chars        (FLAG_DESCRIPTION only, at most 255 chars)
+* All integers are little endian.
+*
+* The buffer is kept across ticks, after the first ticks encoding does not allocate anymore.
+*/
+class CommandBatch
+{
+public:
+	enum Kind
+	{
+		KIND_ATTACK = 1,
+		KIND_CHARGE = 2,
+	};
+
+	enum
+	{
+		KIND_MASK = 0x0F,
+		FLAG_LOOK_AT = 0x10,
+		FLAG_DESCRIPTION = 0x20,
+		POSITION_SCALE = 64,
+	};
+
+	CommandBatch() : m_Count(0), m_Descriptions(false) {}
+
+	/**
+	* Whether descriptions are written, they only help debugging.
+	*/
+	void setDescriptions(bool descriptions) { m_Descriptions = descriptions; }
+	bool hasDescriptions() const { return m_Descriptions; }
+
+	void reserve(size_t bytes) { m_Buffer.reserve(bytes); }
+
+	void clear()
+	{
+		m_Buffer.clear();
+		m_Count = 0;
+	}
+
+	size_t size() const { return m_Count; }
+	bool empty() const { return m_Count == 0; }
+
+	const boost::uint8_t* getData() const { return m_Buffer.empty() ? NULL : &m_Buffer[0]; }
+	size_t getByteSize() const { return m_Buffer.size(); }
+
+	void attack(BotId botId, const Vector2& target, const boost::optional<Vector2>& lookAt, const string& description)
+	{
+		writeRecord(KIND_ATTACK, botId, target, lookAt, description);
+	}
+
+	void charge(BotId botId, const Vector2& target, const string& description)
+	{
+		writeRecord(KIND_CHARGE, botId, target, boost::none, description);
+	}
+
+	/**
+	* Encodes a command of the API, returns false for kinds a batch cannot carry.
+	*/
+	bool add(BotId botId, const Command& command)
+	{
+		if (const AttackCommand* attack = dynamic_cast<const AttackCommand*>(&command))
+		{
+			this->attack(botId, attack->target.front(), attack->lookAt, attack->description);
+			return true;
+		}
+		if (const ChargeCommand* charge = dynamic_cast<const ChargeCommand*>(&command))
+		{
+			this->charge(botId, charge->target.front(), charge->description);
+			return true;
+		}
+		return false;
+	}
+
+	/**
+	* Decodes the records of a batch one after the other.
+	*/
+	class Reader
+	{
+	public:
+		Reader(const CommandBatch& batch)
+			: m_pData(batch.getData()), m_Size(batch.getByteSize()), m_Offset(0) {}
+
+		/**
+		* Reads the next command into the given one, reusing its description.
+		* Returns false at the end of the batch.
+		*/
+		bool next(BatchedCommand& command)
+		{
+			if (m_Offset >= m_Size)
+			{
+				return false;
+			}
+
+			boost::uint8_t header = m_pData[m_Offset++];
+			command.m_Kind = header & KIND_MASK;
+			command.m_BotId = readUInt16();
+			command.m_Target = readPosition();
+			if (header & FLAG_LOOK_AT)
+			{
+				command.m_LookAt = readPosition();
+			} else
+			{
+				command.m_LookAt = boost::none;
+			}
+			if (header & FLAG_DESCRIPTION)
+			{
+				size_t length = m_pData[m_Offset++];
+				command.m_Description.assign((const char*)m_pData + m_Offset, length);
+				m_Offset += length;
+			} else
+			{
+				command.m_Description.clear();
+			}
+			assert(m_Offset <= m_Size);
+			return true;
+		}
+
+	private:
+		const boost::uint8_t* m_pData;
+		size_t m_Size;
+		size_t m_Offset;
+
+		boost::uint16_t readUInt16()
+		{
+			boost::uint16_t value = (boost::uint16_t)(m_pData[m_Offset] | (m_pData[m_Offset + 1] << 8));
+			m_Offset += 2;
+			return value;
+		}
+
+		Vector2 readPosition()
+		{
+			float x = (boost::int16_t)readUInt16();
+			float y = (boost::int16_t)readUInt16();
+			return Vector2(x / POSITION_SCALE, y / POSITION_SCALE);
+		}
+	};
+
+	/**
+	* Position as it arrives at the other end of the batch.
+	*/
+	static Vector2 quantize(const Vector2& position)
+	{
+		return Vector2((float)toFixed(position.x) / POSITION_SCALE, (float)toFixed(position.y) / POSITION_SCALE);
+	}
+
+private:
+	vector<boost::uint8_t> m_Buffer;
+	size_t m_Count;
+	bool m_Descriptions;
+
+	void writeRecord(int kind, BotId botId, const Vector2& target, const boost::optional<Vector2>& lookAt, const string& description)
+	{
+		assert(botId <= 0xFFFF);
+		bool withDescription = m_Descriptions && !description.empty();
+		size_t length = withDescription ? (description.size() < 255 ? description.size() : 255) : 0;
+
+		boost::uint8_t header = (boost::uint8_t)kind;
+		header |= lookAt ? FLAG_LOOK_AT : 0;
+		header |= withDescription ? FLAG_DESCRIPTION : 0;
+
+		m_Buffer.push_back(header);
+		writeUInt16((boost::uint16_t)botId);
+		writePosition(target);
+		if (lookAt)
+		{
+			writePosition(*lookAt);
+		}
+		if (withDescription)
+		{
+			m_Buffer.push_back((boost::uint8_t)length);
+			m_Buffer.insert(m_Buffer.end(), description.begin(), description.begin() + length);
+		}
+		m_Count++;
+	}
+
+	void writeUInt16(boost::uint16_t value)
+	{
+		m_Buffer.push_back((boost::uint8_t)(value & 0xFF));
+		m_Buffer.push_back((boost::uint8_t)(value >> 8));
+	}
+
+	void writePosition(const Vector2& position)
+	{
+		writeUInt16((boost::uint16_t)toFixed(position.x));
+		writeUInt16((boost::uint16_t)toFixed(position.y));
+	}
+
+	/**
+	* Rounds to the nearest step and clamps to the 16-bit range.
+	*/
+	static boost::int16_t toFixed(float value)
+	{
+		float scaled = value * POSITION_SCALE;
+		scaled += scaled < 0.0f ? -0.5f : 0.5f;
+		if (scaled >= 32767.0f)
+		{
+			return 32767;
+		}
+		if (scaled <= -32768.0f)
+		{
+			return -32768;
+		}
+		return (boost::int16_t)scaled;
+	}
+};
+
+/**
+* Receives the command batch of every tick.
+*/
+class CommandSink
+{
+public:
+	virtual ~CommandSink() {}
+
+	/**
+	* Called once per tick, the batch is only valid during the call.
+	*/
+	virtual void flush(const CommandBatch& batch) = 0;
+};
+
+#endif // !defined (COMMAND_BATCH_H)
@@ -0,0 +1,204 @@
+#ifndef COMMAND_GATE_H
+#define COMMAND_GATE_H
+
+#include <vector>
+#include <limits>
+#include <cassert>
+#include <boost/optional.hpp>
+#include <boost/cstdint.hpp>
+#include "../../api/Commands.h"
+#include "BotRegistry.hpp"
+#include "WorldSnapshot.hpp"
+
+using namespace std;
+
+/**
+* Filter between the planer and the server, bots pause their behavior every time they get a new command.
+* Drops a command if it is equivalent to the order its bot is still carrying out, same kind with the targets
+* within the tolerance, or if the bot got that order less than the minimum interval ago.
+* Only orders in flight are compared: update() forgets the order of every bot that is idle again or dead,
+* so an idle bot gets its next command even if it is the same one again, once the minimum interval passed.
+*/
+class CommandGate
+{
+public:
+	CommandGate(float tolerance = 0.5f, float minInterval = 0.5f)
+		: m_Tolerance(tolerance), m_MinInterval(minInterval), m_Suppressed(0) {}
+
+	/**
+	* Largest distance between two targets still considered the same.
+	*/
+	void setTolerance(float tolerance) { m_Tolerance = tolerance; }
+	float getTolerance() const { return m_Tolerance; }
+
+	/**
+	* Seconds of match time a bot keeps its order before it can get a new one.
+	*/
+	void setMinInterval(float minInterval) { m_MinInterval = minInterval; }
+	float getMinInterval() const { return m_MinInterval; }
+
+	/**
+	* Forgets all orders, for a match of the given number of bots.
+	*/
+	void reset(size_t bots)
+	{
+		m_Orders.assign(bots, Order());
+		m_Commands.clear();
+		m_Bots.clear();
+		m_Suppressed = 0;
+	}
+
+	/**
+	* The next command of the bot is not compared to the order it got before, the minimum interval still applies.
+	*/
+	void forget(BotId id)
+	{
+		if (id < m_Orders.size())
+		{
+			m_Orders[id].m_Kind = KIND_NONE;
+		}
+	}
+
+	/**
+	* Forgets the orders of the bots the world shows done with them, available again, or dead.
+	*/
+	void update(const WorldSnapshot& world)
+	{
+		for (BotId id = 0; id < m_Orders.size() && id < world.getBotCount(); id++)
+		{
+			if (world.isAvailable(id) || !world.isAlive(id))
+			{
+				forget(id);
+			}
+		}
+	}
+
+	/**
+	* Keeps the commands worth sending at the given match time, the bots they are for are indexed like the commands.
+	* Returns the number of commands dropped.
+	*/
+	size_t filter(float time, const vector<BotId>& bots, const vector<const Command*>& commands)
+	{
+		assert(bots.size() == commands.size());
+		m_Commands.clear();
+		m_Bots.clear();
+		for (size_t i = 0; i < commands.size(); i++)
+		{
+			BotId id = bots[i];
+			if (id >= m_Orders.size())
+			{
+				m_Orders.resize(id + 1);
+			}
+			Order& order = m_Orders[id];
+			if (time - order.m_Time < m_MinInterval || (order.m_Kind != KIND_NONE && isSame(order, *commands[i])))
+			{
+				continue;
+			}
+			record(order, *commands[i]);
+			order.m_Time = time;
+			m_Commands.push_back(commands[i]);
+			m_Bots.push_back(id);
+		}
+		size_t suppressed = commands.size() - m_Commands.size();
+		m_Suppressed += suppressed;
+		return suppressed;
+	}
+
+	/**
+	* Commands kept by the last filter() and their bots.
+	*/
+	const vector<const Command*>& getCommands() const { return m_Commands; }
+	const vector<BotId>& getBots() const { return m_Bots; }
+
+	/**
+	* Commands dropped since the last reset().
+	*/
+	boost::uint64_t getSuppressedCount() const { return m_Suppressed; }
+
+private:
+	enum Kind
+	{
+		KIND_NONE,
+		KIND_ATTACK,
+		KIND_CHARGE,
+		KIND_OTHER,
+	};
+
+	/**
+	* Last command a bot got and is still carrying out, copied since the commands of the planer are reused,
+	* and when it got it. A bot which never got a command got it infinitely long ago.
+	*/
+	struct Order
+	{
+		Order() : m_Kind(KIND_NONE), m_Time(-numeric_limits<float>::infinity()) {}
+
+		Kind m_Kind;
+		vector<Vector2> m_Target;
+		boost::optional<Vector2> m_LookAt;
+		float m_Time;
+	};
+
+	float m_Tolerance;
+	float m_MinInterval;
+
+	/**
+	* Last order of every bot, indexed by bot id.
+	*/
+	vector<Order> m_Orders;
+
+	vector<const Command*> m_Commands;
+	vector<BotId> m_Bots;
+	boost::uint64_t m_Suppressed;
+
+	void record(Order& order, const Command& command) const
+	{
+		if (const AttackCommand* attack = dynamic_cast<const AttackCommand*>(&command))
+		{
+			order.m_Kind = KIND_ATTACK;
+			order.m_Target = attack->target;
+			order.m_LookAt = attack->lookAt;
+		} else if (const ChargeCommand* charge = dynamic_cast<const ChargeCommand*>(&command))
+		{
+			order.m_Kind = KIND_CHARGE;
+			order.m_Target = charge->target;
+			order.m_LookAt = boost::none;
+		} else
+		{
+			// Kinds the gate does not know are never considered the same
+			order.m_Kind = KIND_OTHER;
+		}
+	}
+
+	bool isSame(const Order& order, const Command& command) const
+	{
+		if (const AttackCommand* attack = dynamic_cast<const AttackCommand*>(&command))
+		{
+			return order.m_Kind == KIND_ATTACK && isNear(order.m_Target, attack->target)
+				&& order.m_LookAt.is_initialized() == attack->lookAt.is_initialized()
+				&& (!attack->lookAt || order.m_LookAt->distance(*attack->lookAt) <= m_Tolerance);
+		}
+		if (const ChargeCommand* charge = dynamic_cast<const ChargeCommand*>(&command))
+		{
+			return order.m_Kind == KIND_CHARGE && isNear(order.m_Target, charge->target);
+		}
+		return false;
+	}
+
+	bool isNear(const vector<Vector2>& a, const vector<Vector2>& b) const
+	{
+		if (a.size() != b.size())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			if (a[i].distance(b[i]) > m_Tolerance)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+#endif // !defined (COMMAND_GATE_H)
@@ -0,0 +1,119 @@
+#ifndef COMMAND_POOL_H
+#define COMMAND_POOL_H
+
+#include <vector>
+#include <memory>
+#include <cassert>
+#include "../../api/Commands.h"
+
+using namespace std;
+
+/**
+* Per-match arena of commands with one slot per bot.
+* Every slot keeps one command object of each kind and reuses it, strings included,
+* every time the bot emits a new command. After the first few ticks emitting a command
+* does not allocate anymore.
+*
+* A command handed out by the pool stays valid until its slot emits the next command of the same kind,
+* unless it is released to the caller. Different slots may be used from different threads.
+*/
+class CommandPool
+{
+private:
+	struct Slot
+	{
+		unique_ptr<AttackCommand> m_Attack;
+		unique_ptr<ChargeCommand> m_Charge;
+	};
+
+	vector<Slot> m_Slots;
+
+public:
+	/**
+	* Makes sure there is a slot for each of the given number of bots.
+	* Must not be called while slots are in use by other threads.
+	*/
+	void reserve(size_t slots)
+	{
+		if (slots > m_Slots.size())
+		{
+			m_Slots.resize(slots);
+		}
+	}
+
+	size_t size() const { return m_Slots.size(); }
+
+	const Command* attack(size_t slot, const string& botId, const Vector2& target, const boost::optional<Vector2>& lookAt, const char* description)
+	{
+		assert(slot < m_Slots.size());
+		unique_ptr<AttackCommand>& command = m_Slots[slot].m_Attack;
+		if (!command)
+		{
+			command.reset(new AttackCommand(botId, target, lookAt, description));
+			return command.get();
+		}
+
+		command->botId.assign(botId);
+		command->description.assign(description);
+		command->target.assign(1, target);
+		command->lookAt = lookAt;
+		return command.get();
+	}
+
+	const Command* charge(size_t slot, const string& botId, const Vector2& target, const char* description)
+	{
+		assert(slot < m_Slots.size());
+		unique_ptr<ChargeCommand>& command = m_Slots[slot].m_Charge;
+		if (!command)
+		{
+			command.reset(new ChargeCommand(botId, target, description));
+			return command.get();
+		}
+
+		command->botId.assign(botId);
+		command->description.assign(description);
+		command->target.assign(1, target);
+		return command.get();
+	}
+
+	/**
+	* Hands the command the slot emitted last over to the caller, who owns it from now on,
+	* for APIs like Commander::issue() that take ownership of what they get.
+	* The slot allocates a new command of that kind the next time, instead of a copy being made now.
+	*/
+	Command* release(size_t slot, const Command& command)
+	{
+		assert(slot < m_Slots.size());
+		Slot& owner = m_Slots[slot];
+		if (owner.m_Attack.get() == &command)
+		{
+			return owner.m_Attack.release();
+		}
+		if (owner.m_Charge.get() == &command)
+		{
+			return owner.m_Charge.release();
+		}
+		assert(false && "Command not emitted by the slot");
+		return clone(command);
+	}
+
+	/**
+	* Copies a pooled command into one the caller owns,
+	* for APIs like Commander::issue() that take ownership of what they get.
+	*/
+	static Command* clone(const Command& command)
+	{
+		if (const AttackCommand* attack = dynamic_cast<const AttackCommand*>(&command))
+		{
+			return new AttackCommand(*attack);
+		}
+		if (const ChargeCommand* charge = dynamic_cast<const ChargeCommand*>(&command))
+		{
+			return new ChargeCommand(*charge);
+		}
+		assert(false && "Command kind not handled by the pool");
+		return NULL;
+	}
+};
+
+#endif // !defined (COMMAND_POOL_H)
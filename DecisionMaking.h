@@ -3,10 +3,27 @@
 
 #include <iostream>
 #include <memory>
+#include <vector>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cassert>
+#include <boost/cstdint.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/locks.hpp>
 #include "../../api/Commands.h"
+#include "ProfileIndex.h"
 
 using namespace std;
 
+/**
+* State of the world decisions are made on, defined by the game.
+*/
+class WorldSnapshot;
+
 namespace dms{
 
 	/**
@@ -16,90 +33,563 @@ namespace dms{
 	class DecisionMaking
 	{
 	public:
-		virtual const Command* tick() = 0;
+		/**
+		* Chooses the next action on the given state of the world, which must not be changed while deciding.
+		*/
+		virtual const Command* tick(const WorldSnapshot& world) = 0;
 	};
 
+	typedef boost::uint16_t FeatureId;
+
 	/**
-	* Represents a player feature, like 'movement', 'physical attacks', 'defensive actions' and so on...
+	* Interns feature names to small dense ids, so profiles store and compare ids instead of strings.
+	* Names are interned rarely and looked up often, possibly from the threads of the planer,
+	* so lookups share the lock.
 	*/
-	class Feature
+	class FeatureSchema
 	{
 	private:
-		string m_Name;
-		int m_Value;
+		mutable boost::shared_mutex m_Mutex;
+
+		/**
+		* A deque keeps the names in place, so references to them stay valid while others are interned.
+		*/
+		deque<string> m_Names;
+		unordered_map<string, FeatureId> m_Ids;
+
 	public:
-		Feature(string name, int value)
+		enum { NO_FEATURE = 0xFFFF };
+
+		/**
+		* The schema the ids of all features in profiles refer to.
+		*/
+		static FeatureSchema& getDefault()
+		{
+			static FeatureSchema schema;
+			return schema;
+		}
+
+		/**
+		* Id of the given name, a new one if the name is not known yet.
+		*/
+		FeatureId intern(const string& name)
+		{
+			FeatureId id = getId(name);
+			if (id != NO_FEATURE)
+			{
+				return id;
+			}
+
+			boost::unique_lock<boost::shared_mutex> lock(m_Mutex);
+			auto found = m_Ids.find(name);
+			if (found != m_Ids.end())
+			{
+				return found->second;
+			}
+			assert(m_Names.size() < NO_FEATURE);
+			id = (FeatureId)m_Names.size();
+			m_Ids[name] = id;
+			m_Names.push_back(name);
+			return id;
+		}
+
+		FeatureId getId(const string& name) const
+		{
+			boost::shared_lock<boost::shared_mutex> lock(m_Mutex);
+			auto found = m_Ids.find(name);
+			return found != m_Ids.end() ? found->second : NO_FEATURE;
+		}
+
+		const string& getName(FeatureId id) const
+		{
+			boost::shared_lock<boost::shared_mutex> lock(m_Mutex);
+			return m_Names[id];
+		}
+
+		size_t size() const
+		{
+			boost::shared_lock<boost::shared_mutex> lock(m_Mutex);
+			return m_Names.size();
+		}
+
+		void clear()
+		{
+			boost::unique_lock<boost::shared_mutex> lock(m_Mutex);
+			m_Names.clear();
+			m_Ids.clear();
+		}
+	};
+
+	/**
+	* Player features, like 'movement', 'physical attacks', 'defensive actions' and so on...
+	* The value of every feature is stored at its id in the default schema, in one array padded
+	* with zeros to a multiple of four values. A feature never set is zero.
+	*/
+	class FeatureVector
+	{
+	private:
+		vector<float> m_Values;
+
+	public:
+		/**
+		* Number of values, a multiple of four.
+		*/
+		size_t size() const { return m_Values.size(); }
+		const float* data() const { return m_Values.data(); }
+
+		float get(FeatureId id) const { return id < m_Values.size() ? m_Values[id] : 0.0f; }
+		float get(const string& name) const { return get(FeatureSchema::getDefault().getId(name)); }
+
+		void set(FeatureId id, float value)
 		{
-			m_Name = name;
-			m_Value = value;
+			assert(id != FeatureSchema::NO_FEATURE);
+			if (id >= m_Values.size())
+			{
+				m_Values.resize((id + 4) & ~(size_t)3, 0.0f);
+			}
+			m_Values[id] = value;
+		}
+
+		void set(const string& name, float value) { set(FeatureSchema::getDefault().intern(name), value); }
+
+		/**
+		* Number of features set to a value other than zero.
+		*/
+		size_t count() const
+		{
+			size_t count = 0;
+			for (auto iter = m_Values.begin(); iter != m_Values.end(); ++iter)
+			{
+				count += *iter != 0.0f ? 1 : 0;
+			}
+			return count;
 		}
 
-		string getName() { return m_Name; }
-		int getValue() { return m_Value; }
-		void setValue(int value) { m_Value = value; }
+		void clear() { m_Values.clear(); }
+
+		/**
+		* Whether every feature has the same value, features never set being zero.
+		*/
+		bool operator==(const FeatureVector& other) const
+		{
+			size_t size = max(m_Values.size(), other.m_Values.size());
+			for (size_t id = 0; id < size; id++)
+			{
+				if (get((FeatureId)id) != other.get((FeatureId)id))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
 	};
 
 	/**
-	* Represents a weighted connection with a DMS.
+	* Weights of the connections between profiles, the rows, and all available DMSs, the columns.
+	* All rows are kept in one array, each padded to a multiple of four weights with the lowest weight,
+	* so the best DMS of a profile is found with one scan over its row.
+	* A greater weight means a better performance against the style of the profile.
 	*/
-	class ProfileConnection
+	class WeightMatrix
 	{
 	private:
-		DecisionMaking* m_DecisionMaker;
-		int m_Weight;
-	
+		vector<DecisionMaking*> m_DecisionMakers;
+		size_t m_Stride;
+		size_t m_Rows;
+		vector<int> m_Weights;
+
 	public:
-		ProfileConnection (DecisionMaking& decisionMaker, int weight)
-			: m_DecisionMaker(&decisionMaker), m_Weight(weight) {}
+		enum
+		{
+			/**
+			* Weight of the first DMS of a new row, every next one gets one less.
+			*/
+			DEFAULT_WEIGHT = 1000,
+		};
 
-		int getWeight() { return m_Weight; }
-		void setWeight(int newWeight) { m_Weight = newWeight; }
+		WeightMatrix(const vector<DecisionMaking*>& decisionMakers)
+			: m_DecisionMakers(decisionMakers), m_Stride((decisionMakers.size() + 3) & ~(size_t)3), m_Rows(0) {}
 
-		DecisionMaking* getDecisionMaker() { return m_DecisionMaker; }
+		size_t getColumnCount() const { return m_DecisionMakers.size(); }
+		size_t getRowCount() const { return m_Rows; }
+		DecisionMaking* getDecisionMaker(size_t column) const { return m_DecisionMakers[column]; }
+
+		/**
+		* Adds a row with the default weights, the first DMS in the list receives the biggest one.
+		*/
+		size_t addRow()
+		{
+			m_Weights.resize((m_Rows + 1) * m_Stride, numeric_limits<int>::min());
+			int* row = getRow(m_Rows);
+			for (size_t i = 0; i < getColumnCount(); i++)
+			{
+				row[i] = DEFAULT_WEIGHT - (int)i;
+			}
+			return m_Rows++;
+		}
+
+		/**
+		* Weights of the row, padded to a multiple of four. Without any DMS rows are empty.
+		*/
+		int* getRow(size_t row) { return m_Weights.data() + row * m_Stride; }
+		const int* getRow(size_t row) const { return m_Weights.data() + row * m_Stride; }
+
+		int get(size_t row, size_t column) const { return getRow(row)[column]; }
+		void set(size_t row, size_t column, int weight) { getRow(row)[column] = weight; }
+
+		/**
+		* Column of the highest weight of the row, the first of them on a tie.
+		*/
+		size_t selectBest(size_t row) const
+		{
+			const int* weights = getRow(row);
+			int best0 = numeric_limits<int>::min(), best1 = best0, best2 = best0, best3 = best0;
+			for (size_t i = 0; i < m_Stride; i += 4)
+			{
+				best0 = max(best0, weights[i]);
+				best1 = max(best1, weights[i + 1]);
+				best2 = max(best2, weights[i + 2]);
+				best3 = max(best3, weights[i + 3]);
+			}
+			int best = max(max(best0, best1), max(best2, best3));
+			size_t column = 0;
+			while (column + 1 < getColumnCount() && weights[column] != best)
+			{
+				column++;
+			}
+			return column;
+		}
 	};
 
 	/**
 	* It is composed by a set of features that identifies a specific player style
-	* and a set of weighted connections to all available DMSs in the CDMS.
-	* A greater weight means a better performance against a specific style.
+	* and a set of weighted connections to all available DMSs in the CDMS, a row of a weight matrix.
+	* Copies of a profile share its row.
 	*/
 	class Profile
 	{
 	private:
+		WeightMatrix* m_Weights;
+		size_t m_Row;
+
 		/**
 		* Responsible for choosing the best action to perform based on the world's state and send it to the associated NPC.
 		* It is chosen upon the highest weighted connection between the current profile and all available DMSs.
 		*/
-		ProfileConnection *m_CurrentDMS;
-		vector<ProfileConnection*> m_Connections;
-		vector<Feature> m_Features; // TODO: change to set
+		size_t m_Current;
+
+		/**
+		* Matrix of a profile initialized on its own, which is its only row.
+		*/
+		shared_ptr<WeightMatrix> m_OwnWeights;
+
+		FeatureVector m_Features;
 
 	public:
+		Profile() : m_Weights(NULL), m_Row(0), m_Current(0) {}
 		~Profile() {}
+
 		/*
-		* Constructs a matrix of connections with every DMS with default weight values.
+		* Connects to every DMS with default weight values, in a row added to the given matrix.
 		* The first DMS in the list will receive the biggest value and will be selected as the current one.
 		*/
+		void init(WeightMatrix& weights)
+		{
+			m_OwnWeights.reset();
+			m_Weights = &weights;
+			m_Row = weights.addRow();
+			m_Current = 0;
+		}
+
+		/*
+		* Same as above for a profile outside of any manager, in a matrix of its own.
+		*/
 		virtual void init(vector<DecisionMaking*> availableDecisionMakers) 
 		{
-			if (availableDecisionMakers.empty()) {
+			shared_ptr<WeightMatrix> weights(new WeightMatrix(availableDecisionMakers));
+			init(*weights);
+			m_OwnWeights = weights;
+		}
+
+		size_t getDecisionMakerCount() const { return m_Weights != NULL ? m_Weights->getColumnCount() : 0; }
+		size_t getRow() const { return m_Row; }
+
+		int getWeight(size_t decisionMaker) const { return m_Weights->get(m_Row, decisionMaker); }
+		void setWeight(size_t decisionMaker, int weight) { m_Weights->set(m_Row, decisionMaker, weight); }
+
+		/**
+		* Current DMS, NULL if there is none.
+		*/
+		DecisionMaking* getCurrentDecisionMaker() const { return getDecisionMakerCount() > 0 ? m_Weights->getDecisionMaker(m_Current) : NULL; }
+		size_t getCurrentIndex() const { return m_Current; }
+		int getCurrentWeight() const { return getWeight(m_Current); }
+		void setCurrentWeight(int weight) { setWeight(m_Current, weight); }
+
+		FeatureVector& getFeatures() { return m_Features; }
+
+		/**
+		* Makes the highest weighted connection the current one, e.g. after the weights were loaded or updated.
+		*/
+		void selectBestDecisionMaker()
+		{
+			if (getDecisionMakerCount() > 0)
+			{
+				m_Current = m_Weights->selectBest(m_Row);
+			}
+		}
+	};
+
+	/**
+	* How a weight learns from a reward, pluggable into the weight update engine.
+	* Rewards range from -1, the DMS performed badly, to 1, it performed well.
+	*/
+	class WeightUpdateRule
+	{
+	public:
+		virtual ~WeightUpdateRule() {}
+		virtual int update(int weight, float reward) const = 0;
+	};
+
+	/**
+	* Bandit style update with a constant learning rate: the weight moves that fraction of the way to
+	* the value of the reward, twice the default weight for 1 and 0 for -1, so recent rewards count most.
+	*/
+	class BanditUpdateRule : public WeightUpdateRule
+	{
+	private:
+		float m_LearningRate;
+
+	public:
+		BanditUpdateRule(float learningRate = 0.2f) : m_LearningRate(learningRate) {}
+
+		float getLearningRate() const { return m_LearningRate; }
+		void setLearningRate(float learningRate) { m_LearningRate = learningRate; }
+
+		virtual int update(int weight, float reward) const
+		{
+			float target = WeightMatrix::DEFAULT_WEIGHT * (1.0f + reward);
+			return weight + (int)floor(m_LearningRate * (target - weight) + 0.5f);
+		}
+	};
+
+	/**
+	* Collects rewards for connections of a weight matrix and applies them all at once, away from the tick.
+	* Rewards of the same connection are combined first, each one older than the last counting
+	* the decay times less, so a connection is updated once per batch.
+	*/
+	class WeightUpdateEngine
+	{
+	private:
+		struct Reward
+		{
+			size_t m_Row;
+			size_t m_Column;
+			float m_Reward;
+
+			bool operator<(const Reward& other) const
+			{
+				return m_Row != other.m_Row ? m_Row < other.m_Row : m_Column < other.m_Column;
+			}
+		};
+
+		const WeightUpdateRule* m_Rule;
+		float m_Decay;
+		vector<Reward> m_Pending;
+
+	public:
+		WeightUpdateEngine(const WeightUpdateRule* rule = NULL, float decay = 0.5f) : m_Rule(rule), m_Decay(decay) {}
+
+		/**
+		* NULL disables the engine, rewards are dropped then.
+		*/
+		void setRule(const WeightUpdateRule* rule) { m_Rule = rule; }
+		const WeightUpdateRule* getRule() const { return m_Rule; }
+		void setDecay(float decay) { m_Decay = decay; }
+
+		size_t getPendingCount() const { return m_Pending.size(); }
+
+		void addReward(size_t row, size_t column, float reward)
+		{
+			if (m_Rule != NULL)
+			{
+				Reward pending = { row, column, max(-1.0f, min(1.0f, reward)) };
+				m_Pending.push_back(pending);
+			}
+		}
+
+		/**
+		* Updates every connection with pending rewards, returns the number of weights changed.
+		*/
+		size_t apply(WeightMatrix& weights)
+		{
+			if (m_Pending.empty())
+			{
+				return 0;
+			}
+
+			// Stable, so the rewards of a connection stay in the order they came in
+			stable_sort(m_Pending.begin(), m_Pending.end());
+			size_t updated = 0;
+			for (size_t begin = 0; begin < m_Pending.size(); updated++)
+			{
+				const Reward& first = m_Pending[begin];
+				float reward = 0.0f;
+				float total = 0.0f;
+				size_t end = begin;
+				for (; end < m_Pending.size() && !(first < m_Pending[end]); end++)
+				{
+					reward = reward * m_Decay + m_Pending[end].m_Reward;
+					total = total * m_Decay + 1.0f;
+				}
+				weights.set(first.m_Row, first.m_Column, m_Rule->update(weights.get(first.m_Row, first.m_Column), reward / total));
+				begin = end;
+			}
+			m_Pending.clear();
+			return updated;
+		}
+	};
+
+	/**
+	* Abstract base class for a persistent collection of profiles,
+	* loaded by a Profile Manager when it starts and added to when a session ends.
+	*/
+	class ProfileLibrary
+	{
+	public:
+		virtual size_t size() const = 0;
+
+		/**
+		* Fills a profile with the stored one at the given index.
+		* The profile gets a new row of the given matrix first, the stored weights follow the order of its DMSs.
+		*/
+		virtual void load(size_t index, Profile& profile, WeightMatrix& weights) const = 0;
+
+		/**
+		* Reads only the features of the stored profile at the given index, to search the library without loading it.
+		*/
+		virtual void loadFeatures(size_t index, FeatureVector& features) const = 0;
+
+		virtual void add(Profile& profile) = 0;
+	};
+
+	/**
+	* Features of the profiles searched on an alert: those of the library, then those created during the session.
+	* One is shared by the Profile Managers of a team, so the library is indexed once and every profile style
+	* has one entry, whichever manager created it. Managers alerted with the same features share one search.
+	*/
+	class LibraryIndex
+	{
+	private:
+		ProfileLibrary* m_Library;
+		bool m_Initialized;
+		size_t m_LibrarySize;
+
+		/**
+		* One dimension per feature of the default schema.
+		*/
+		ProfileIndex m_Index;
+		vector<FeatureVector> m_SessionFeatures;
+		vector<float> m_Point;
+
+		/**
+		* Query and result of the last search, valid until an entry is added.
+		*/
+		FeatureVector m_LastQuery;
+		ProfileMatch m_LastMatch;
+		bool m_HasLastMatch;
+		size_t m_SearchCount;
+
+		/**
+		* Vector of the given features in the index dimension; features interned since the last call grow the dimension.
+		*/
+		const float* toPoint(const FeatureVector& features)
+		{
+			size_t known = FeatureSchema::getDefault().size();
+			if (known > m_Index.getDimension())
+			{
+				m_Index.setDimension(known);
+			}
+			size_t dimension = m_Index.getDimension();
+			m_Point.assign(features.data(), features.data() + min(features.size(), dimension));
+			m_Point.resize(dimension, 0.0f);
+			return m_Point.data();
+		}
+
+	public:
+		LibraryIndex() : m_Library(NULL), m_Initialized(false), m_LibrarySize(0), m_HasLastMatch(false), m_SearchCount(0) {}
+
+		/**
+		* Indexes the features of every profile of the library, NULL for none. Only the first call does.
+		*/
+		void init(ProfileLibrary* library)
+		{
+			if (m_Initialized)
+			{
+				assert(library == m_Library);
 				return;
 			}
+			m_Initialized = true;
+			m_Library = library;
+			m_LibrarySize = library != NULL ? library->size() : 0;
+			FeatureVector features;
+			for (size_t i = 0; i < m_LibrarySize; i++)
+			{
+				library->loadFeatures(i, features);
+				m_Index.add(toPoint(features));
+			}
+			m_Index.build();
+		}
 
-			vector<ProfileConnection*> connections;
-			// Starts with 1000 and go down
-			int w = 1000;
-			for (auto iter = availableDecisionMakers.begin(); iter != availableDecisionMakers.end(); ++iter)
+		size_t size() const { return m_Index.size(); }
+
+		/**
+		* Whether the entry is one of the library, loaded from there, or one created during the session.
+		*/
+		bool isLibraryProfile(size_t index) const { return index < m_LibrarySize; }
+		const FeatureVector& getSessionFeatures(size_t index) const { return m_SessionFeatures[index - m_LibrarySize]; }
+
+		/**
+		* Adds an entry for a profile created during the session, returns its index.
+		* It is the match of the next search for the same features.
+		*/
+		size_t add(const FeatureVector& features)
+		{
+			size_t index = m_Index.add(toPoint(features));
+			m_SessionFeatures.push_back(features);
+			m_LastQuery = features;
+			m_LastMatch.m_Index = index;
+			m_LastMatch.m_Distance = 0.0f;
+			m_HasLastMatch = true;
+			return index;
+		}
+
+		/**
+		* Nearest entry to the given features.
+		*/
+		ProfileMatch findNearest(const FeatureVector& features)
+		{
+			if (m_HasLastMatch && features == m_LastQuery)
 			{
-				// Create matrix of connections
-				connections.push_back(new ProfileConnection((**iter), w--));
+				return m_LastMatch;
 			}
 
-			m_CurrentDMS = *(&connections.front());
-			m_Connections = connections;
+			// The tree is rebuilt once enough vectors are outside of it, or the dimension grew
+			const float* point = toPoint(features);
+			if (m_Index.getUnindexedCount() > max((size_t)ProfileIndex::BRUTE_FORCE_SIZE, m_Index.size() / 8))
+			{
+				m_Index.build();
+			}
+			m_LastQuery = features;
+			m_LastMatch = m_Index.findNearest(point);
+			m_HasLastMatch = true;
+			m_SearchCount++;
+			return m_LastMatch;
 		}
 
-		ProfileConnection* getCurrentConnection() { return m_CurrentDMS; }
+		/**
+		* Searches run so far, those answered by the last one do not count.
+		*/
+		size_t getSearchCount() const { return m_SearchCount; }
 	};
 
 	/**
@@ -118,9 +608,48 @@ namespace dms{
 		Profile *m_LastUsedProfile;
 		Profile *m_CurrentProfile;
 
-		vector<Profile> m_Profiles;
+		/**
+		* Profiles of this session, a deque so the profiles keep their address when more are added.
+		*/
+		deque<Profile> m_Profiles;
 		vector<DecisionMaking*> m_DecisionMakers;
 
+		/**
+		* Weights of all profiles of this session, one row each.
+		*/
+		WeightMatrix m_Weights;
+
+		/**
+		* Features of the opponent observed since the last reset, compared against the profiles on an alert.
+		*/
+		FeatureVector m_InternalFeatures;
+
+		/**
+		* Largest distance between the internal features and a profile for the profile to be similar.
+		*/
+		float m_SimilarityThreshold;
+
+		/**
+		* Where profiles are loaded from and saved to, NULL to keep them for this session only.
+		*/
+		ProfileLibrary* m_Library;
+
+		/**
+		* Whether the current profile changed since it was loaded or saved.
+		*/
+		bool m_Changed;
+
+		/**
+		* Batches the rewards of the current connection when a rule is set, otherwise alerts update
+		* the weight right away through performanceUpdate().
+		*/
+		WeightUpdateEngine m_Engine;
+
+		/**
+		* Reward of an alert, the activation condition identified a bad performance.
+		*/
+		static float getAlertReward() { return -1.0f; }
+
 		/**
 		* Performance update function.
 		* >= 0 if performance is satisfying
@@ -130,14 +659,44 @@ namespace dms{
 		*/
 		virtual int performanceUpdate(DecisionMaking& decisionMaker, int currentWeight) = 0;
 
+		/**
+		* Brings the internal features up to date with the world, called every tick.
+		* Without a view of the world they are reset.
+		*/
+		virtual void updateInternalFeatures()
+		{
+			resetInternalFeatures();
+		}
+
+	private:
+		/**
+		* Profiles searched on an alert, the manager's own unless one shared with other managers is set.
+		* m_IndexedProfiles holds the profile of every entry, NULL for those which are only loaded or created
+		* once they are the most similar one.
+		*/
+		LibraryIndex m_OwnIndex;
+		LibraryIndex* m_Index;
+		vector<Profile*> m_IndexedProfiles;
+
+		/**
+		* Profiles of m_Profiles the index knows, those a subclass added after them are indexed on the next alert.
+		*/
+		size_t m_IndexedSessionProfiles;
+
 	public:
 		ProfileManager(vector<DecisionMaking*> decisionMakers)
+			: m_Weights(decisionMakers)
 		{ 
 			m_Initialized = false;
 			m_DecisionMakers = decisionMakers;
+			m_Library = NULL;
+			m_Changed = false;
+			m_SimilarityThreshold = 1.0f;
+			m_Index = &m_OwnIndex;
+			m_IndexedSessionProfiles = 0;
 
 			m_DefaultProfile = new Profile();
-			m_DefaultProfile->init(m_DecisionMakers);
+			m_DefaultProfile->init(m_Weights);
 		}
 
 		~ProfileManager() { 
@@ -152,7 +711,16 @@ namespace dms{
 				return;
 			}
 
-			// TODO: load available profiles
+			// The library stays where it is, only the most recent profile is loaded
+			m_Index->init(m_Library);
+			if (m_Library != NULL && m_Library->size() > 0)
+			{
+				m_Profiles.push_back(Profile());
+				m_Library->load(m_Library->size() - 1, m_Profiles.back(), m_Weights);
+				m_LastUsedProfile = &m_Profiles.back();
+				getIndexedSlot(m_Library->size() - 1) = m_LastUsedProfile;
+				m_IndexedSessionProfiles++;
+			}
 
 			if (m_Profiles.empty())
 			{
@@ -170,10 +738,7 @@ namespace dms{
 			if (!m_Initialized) {
 				init();
 			}
-			// TODO: check world state
-			// TODO: if its a new game session then 
-			resetInternalFeatures();
-			// TODO: if state changed then update internal features
+			updateInternalFeatures();
 		}
 
 		/**
@@ -182,19 +747,19 @@ namespace dms{
 		virtual void alert()
 		{
 			// Alert received!
-			if (!m_Profiles.empty())
+			indexAddedProfiles();
+			ProfileMatch match = m_Index->findNearest(m_InternalFeatures);
+			if (match.found() && match.m_Distance <= m_SimilarityThreshold)
 			{
-				// TODO: search similar profile on stored profiles
-				// TODO: set current profile as similar profile
-				// TODO: if similarity > similarity threshold then 
-				// TODO:	update weight of connection between current profile and current DMS
+				m_CurrentProfile = getIndexedProfile(match.m_Index);
+				// Its weights may have learned since it was current
+				m_CurrentProfile->selectBestDecisionMaker();
 				updateCurrentWeight();
+				m_Changed = true;
 				resetInternalFeatures();
-				// TODO: else 
-				createProfileFromCurrent();
 			}
 			else
-				// There are no stored profiles
+				// There are no stored profiles or none is similar enough
 			{
 				createProfileFromCurrent();
 			}
@@ -203,28 +768,178 @@ namespace dms{
 		
 
 		Profile* getCurrentProfile() { return m_CurrentProfile; }
+
+		const vector<DecisionMaking*>& getDecisionMakers() const { return m_DecisionMakers; }
+
+		/**
+		* Must be set before init() to load the profiles of earlier sessions.
+		*/
+		void setProfileLibrary(ProfileLibrary* library) { m_Library = library; }
+
+		/**
+		* Index shared with the other managers of the same library, must be set before init().
+		*/
+		void setLibraryIndex(LibraryIndex* index) { m_Index = index; }
+
+		void setSimilarityThreshold(float threshold) { m_SimilarityThreshold = threshold; }
+
+		/**
+		* Rule the weights learn with from batched rewards, NULL to update them on every alert instead.
+		*/
+		void setWeightUpdateRule(const WeightUpdateRule* rule, float decay = 0.5f)
+		{
+			m_Engine.setRule(rule);
+			m_Engine.setDecay(decay);
+		}
+
+		/**
+		* Rewards the current DMS of the current profile, e.g. with the outcome of the match.
+		* Only takes effect with the next applyRewards().
+		*/
+		void reward(float reward)
+		{
+			if (m_CurrentProfile->getDecisionMakerCount() > 0)
+			{
+				m_Engine.addReward(m_CurrentProfile->getRow(), m_CurrentProfile->getCurrentIndex(), reward);
+			}
+		}
+
+		size_t getPendingRewardCount() const { return m_Engine.getPendingCount(); }
+
+		/**
+		* Updates the weights with all rewards since the last call, then selects the best DMS again.
+		*/
+		void applyRewards()
+		{
+			if (m_Engine.apply(m_Weights) > 0)
+			{
+				m_CurrentProfile->selectBestDecisionMaker();
+				m_Changed = true;
+			}
+		}
+
+		/**
+		* Adds the current profile to the library if it changed, called once the session ends.
+		*/
+		virtual void save()
+		{
+			if (m_Library != NULL && m_Changed)
+			{
+				m_Library->add(*takeChangedProfile());
+			}
+		}
+
+		/**
+		* Current profile if it changed since it was loaded or saved, which then counts as saved, NULL otherwise.
+		*/
+		Profile* takeChangedProfile()
+		{
+			if (!m_Changed)
+			{
+				return NULL;
+			}
+			m_Changed = false;
+			return m_CurrentProfile;
+		}
 	private:
+		/**
+		* Makes a new profile of the internal features current, starting from the weights of the current one.
+		* It is indexed at once and saved to the library at the end of the session.
+		*/
 		void createProfileFromCurrent()
 		{
-			// TODO: set features of current profile with internal features
-			// TODO: update weight of connection between current profile and current DMS
-			// TODO: store/save current profile
+			Profile& profile = addProfileFromCurrent(m_InternalFeatures);
+			getIndexedSlot(m_Index->add(m_InternalFeatures)) = &profile;
+
+			m_CurrentProfile = &profile;
+			updateCurrentWeight();
+			m_Changed = true;
 			resetInternalFeatures();
 		}
 
 		void resetInternalFeatures() 
 		{
-			// TODO reset internal player features set (internal features)
+			m_InternalFeatures.clear();
 		}
 
 		/**
-		* Updates weight between the current profile and the current DMS.
+		* Profile of this session with the given features and the weights of the current one.
+		*/
+		Profile& addProfileFromCurrent(const FeatureVector& features)
+		{
+			m_Profiles.push_back(Profile());
+			Profile& profile = m_Profiles.back();
+			profile.init(m_Weights);
+			for (size_t i = 0; i < profile.getDecisionMakerCount(); i++)
+			{
+				profile.setWeight(i, m_CurrentProfile->getWeight(i));
+			}
+			profile.getFeatures() = features;
+			profile.selectBestDecisionMaker();
+			m_IndexedSessionProfiles++;
+			return profile;
+		}
+
+		void indexAddedProfiles()
+		{
+			for (; m_IndexedSessionProfiles < m_Profiles.size(); m_IndexedSessionProfiles++)
+			{
+				Profile& profile = m_Profiles[m_IndexedSessionProfiles];
+				getIndexedSlot(m_Index->add(profile.getFeatures())) = &profile;
+			}
+		}
+
+		Profile*& getIndexedSlot(size_t index)
+		{
+			if (index >= m_IndexedProfiles.size())
+			{
+				m_IndexedProfiles.resize(m_Index->size(), NULL);
+			}
+			return m_IndexedProfiles[index];
+		}
+
+		/**
+		* Profile of an indexed entry. A library profile is loaded, one another manager created
+		* during the session starts from the weights of the current profile.
+		*/
+		Profile* getIndexedProfile(size_t index)
+		{
+			Profile*& profile = getIndexedSlot(index);
+			if (profile == NULL)
+			{
+				if (m_Index->isLibraryProfile(index))
+				{
+					m_Profiles.push_back(Profile());
+					m_Library->load(index, m_Profiles.back(), m_Weights);
+					profile = &m_Profiles.back();
+					m_IndexedSessionProfiles++;
+				} else
+				{
+					profile = &addProfileFromCurrent(m_Index->getSessionFeatures(index));
+				}
+			}
+			return profile;
+		}
+
+		/**
+		* Updates weight between the current profile and the current DMS, then selects the best DMS again.
+		* With a weight update rule the alert is queued as a reward instead.
 		*/
 		void updateCurrentWeight()
 		{
+			DecisionMaking* decisionMaker = m_CurrentProfile->getCurrentDecisionMaker();
+			if (decisionMaker == NULL)
+			{
+				return;
+			}
+			if (m_Engine.getRule() != NULL)
+			{
+				reward(getAlertReward());
+				return;
+			}
 			// Updates the weight based on a performance update function
-			ProfileConnection* connection = m_CurrentProfile->getCurrentConnection();
-			connection->setWeight(performanceUpdate(*(connection->getDecisionMaker()), connection->getWeight()));
+			m_CurrentProfile->setCurrentWeight(performanceUpdate(*decisionMaker, m_CurrentProfile->getCurrentWeight()));
+			m_CurrentProfile->selectBestDecisionMaker();
 		}
 	};
 
@@ -235,10 +950,10 @@ namespace dms{
 	{
 	public:
 		/**
-		* Checks if this condition is met.
+		* Checks if this condition is met on the world of the current tick.
 		* True if it is active, false otherwise.
 		*/
-		virtual bool checkCondition() = 0;
+		virtual bool checkCondition(const WorldSnapshot& world) = 0;
 	};
 
 	/**
@@ -256,15 +971,73 @@ namespace dms{
 			: m_AC(&AC), m_ProfileManager(&profileManager) {}
 		~Monitor() { m_AC = NULL; m_ProfileManager = NULL; }
 
-		virtual void update() 
+		virtual void update(const WorldSnapshot& world) 
 		{
-			if (m_AC->checkCondition())
+			if (m_AC->checkCondition(world))
 			{
 				m_ProfileManager->alert();
 			}
 		}
 	};
 
+	/**
+	* Monitor of a whole team: every Activation Condition is checked once per tick, whatever the size
+	* of the team, and an alert goes to the Profile Manager of every bot.
+	* A condition alerts when it becomes met, not again on every tick it stays met.
+	*/
+	class TeamMonitor
+	{
+	private:
+		vector<ActivationCondition*> m_Conditions;
+		vector<char> m_Met;
+		vector<ProfileManager*> m_ProfileManagers;
+		size_t m_AlertCount;
+
+	public:
+		TeamMonitor() : m_AlertCount(0) {}
+
+		void addCondition(ActivationCondition& condition)
+		{
+			m_Conditions.push_back(&condition);
+			m_Met.push_back(0);
+		}
+
+		void addProfileManager(ProfileManager& profileManager) { m_ProfileManagers.push_back(&profileManager); }
+
+		size_t getConditionCount() const { return m_Conditions.size(); }
+		bool isMet(size_t condition) const { return m_Met[condition] != 0; }
+
+		/**
+		* Number of alerts the Profile Managers received so far, one per condition that became met.
+		*/
+		size_t getAlertCount() const { return m_AlertCount; }
+
+		/**
+		* Checks all conditions on the world of the current tick, returns whether the Profile Managers were alerted.
+		*/
+		virtual bool update(const WorldSnapshot& world)
+		{
+			size_t alerts = 0;
+			for (size_t i = 0; i < m_Conditions.size(); i++)
+			{
+				bool met = m_Conditions[i]->checkCondition(world);
+				alerts += met && !m_Met[i] ? 1 : 0;
+				m_Met[i] = met;
+			}
+
+			// Conditions becoming met together are one bad performance, alerted once
+			if (alerts > 0)
+			{
+				for (auto iter = m_ProfileManagers.begin(); iter != m_ProfileManagers.end(); ++iter)
+				{
+					(*iter)->alert();
+				}
+				m_AlertCount++;
+			}
+			return alerts > 0;
+		}
+	};
+
 	/**
 	* Responsible for making decisions based upon observations of the world's state.
 	* It is composed by different Decision Making Systems that are choosen based on the current profile.
@@ -280,6 +1053,7 @@ namespace dms{
 
 		/**
 		* Responsible for watching the world and producing alerts for the Profile Manager.
+		* NULL when a team monitor watches for the whole team.
 		*/
 		Monitor *m_Monitor;
 
@@ -299,24 +1073,29 @@ namespace dms{
 		CompositeDecisionMakingSystem(ProfileManager& profileManager, Monitor& monitor)
 			: m_ProfileManager(&profileManager), m_Monitor(&monitor) {}
 
+		/**
+		* Without a monitor of its own, the Profile Manager is alerted by a team monitor.
+		*/
+		CompositeDecisionMakingSystem(ProfileManager& profileManager)
+			: m_ProfileManager(&profileManager), m_Monitor(NULL) {}
+
 		void init() 
 		{
 			m_ProfileManager->init();
 		}
 
-		const Command* tick()
+		const Command* tick(const WorldSnapshot& world)
 		{
-			m_Monitor->update();
+			if (m_Monitor != NULL)
+			{
+				m_Monitor->update(world);
+			}
 			m_ProfileManager->tick();
 			
 			Profile* m_CurrentProfile = m_ProfileManager->getCurrentProfile();
-			ProfileConnection* connection = m_CurrentProfile->getCurrentConnection();
-			if (NULL != connection) 
-			{
-				DecisionMaking* m_CurrentDecisionMaker = connection->getDecisionMaker();
-				if (m_CurrentDecisionMaker != NULL) {
-					return m_CurrentDecisionMaker->tick();
-				}
+			DecisionMaking* m_CurrentDecisionMaker = m_CurrentProfile->getCurrentDecisionMaker();
+			if (m_CurrentDecisionMaker != NULL) {
+				return m_CurrentDecisionMaker->tick(world);
 			}
 
 			return NULL;
@@ -0,0 +1,256 @@
+#ifndef DISTANCE_FIELD_H
+#define DISTANCE_FIELD_H
+
+#include <vector>
+#include <cmath>
+#include <cassert>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include "../../api/GameInfo.h"
+#include "SpatialGrid.hpp"
+#include "WorldSnapshot.hpp"
+
+using namespace std;
+
+/**
+* Walking distance from every free cell of the level to the nearest of a set of sources,
+* with the neighbour cell to step to on a shortest way there.
+* Computed once by a breadth-first search from all sources together, after which
+* distance and next step of any position are a table lookup.
+* Bots move in eight directions, a step to any neighbour counts as one, and never cut the corner of a block.
+*/
+class DistanceField
+{
+public:
+	enum
+	{
+		/**
+		* Distance of blocked cells and of those the sources cannot be reached from.
+		*/
+		UNREACHABLE = ~0u,
+	};
+
+	DistanceField() : m_Width(0), m_Height(0) {}
+
+	/**
+	* Searches the free cells of the grid from the cells of the given positions, which are clamped into the level.
+	*/
+	void build(const SpatialGrid& grid, const vector<Vector2>& sources)
+	{
+		static const int offsets[8][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 }, { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 } };
+
+		m_Width = grid.getWidth();
+		m_Height = grid.getHeight();
+		m_Distances.assign(m_Width * m_Height, UNREACHABLE);
+		m_Next.assign(m_Width * m_Height, NO_CELL);
+		m_Queue.clear();
+		if (m_Width == 0 || m_Height == 0)
+		{
+			return;
+		}
+
+		for (auto iter = sources.begin(); iter != sources.end(); ++iter)
+		{
+			unsigned cell = getCell(*iter);
+			if (m_Distances[cell] == UNREACHABLE)
+			{
+				m_Distances[cell] = 0;
+				m_Next[cell] = cell;
+				m_Queue.push_back(cell);
+			}
+		}
+
+		for (size_t head = 0; head < m_Queue.size(); head++)
+		{
+			unsigned cell = m_Queue[head];
+			int x = cell % m_Width;
+			int y = cell / m_Width;
+			for (int i = 0; i < 8; i++)
+			{
+				int nx = x + offsets[i][0];
+				int ny = y + offsets[i][1];
+				if (!grid.isFree(nx, ny) || (nx != x && ny != y && !(grid.isFree(nx, y) && grid.isFree(x, ny))))
+				{
+					continue;
+				}
+				unsigned neighbour = ny * m_Width + nx;
+				if (m_Distances[neighbour] == UNREACHABLE)
+				{
+					m_Distances[neighbour] = m_Distances[cell] + 1;
+					m_Next[neighbour] = cell;
+					m_Queue.push_back(neighbour);
+				}
+			}
+		}
+	}
+
+	/**
+	* Steps from the cell of the position to the nearest source, UNREACHABLE if there is no way.
+	*/
+	unsigned getDistance(const Vector2& position) const
+	{
+		return m_Distances.empty() ? (unsigned)UNREACHABLE : m_Distances[getCell(position)];
+	}
+
+	bool isReachable(const Vector2& position) const { return getDistance(position) != UNREACHABLE; }
+
+	/**
+	* Center of the cell to walk to next on the way to the nearest source, false if there is no way.
+	* In the cell of a source the next step is the center of that cell.
+	*/
+	bool getNextStep(const Vector2& position, Vector2& result) const
+	{
+		if (m_Next.empty())
+		{
+			return false;
+		}
+		unsigned next = m_Next[getCell(position)];
+		if (next == NO_CELL)
+		{
+			return false;
+		}
+		result = Vector2((float)(next % m_Width) + 0.5f, (float)(next / m_Width) + 0.5f);
+		return true;
+	}
+
+private:
+	enum
+	{
+		NO_CELL = ~0u,
+	};
+
+	int m_Width;
+	int m_Height;
+
+	/**
+	* Distance and next cell of every cell, row by row, and the search queue, kept to reuse its memory.
+	*/
+	vector<unsigned> m_Distances;
+	vector<unsigned> m_Next;
+	vector<unsigned> m_Queue;
+
+	unsigned getCell(const Vector2& position) const
+	{
+		int x = max(0, min(m_Width - 1, (int)floor(position.x)));
+		int y = max(0, min(m_Height - 1, (int)floor(position.y)));
+		return (unsigned)(y * m_Width + x);
+	}
+};
+
+/**
+* Distance fields to the flags and score locations of both teams.
+* A field is searched lazily, the first time it is read after its target moved to another cell,
+* so fields nobody asks for cost nothing and a carried flag is searched at most once per tick.
+* Reading is safe from the threads ticking the bots, every field is searched under its own lock.
+*/
+class DistanceFieldCache
+{
+public:
+	enum Target
+	{
+		OWN_FLAG,
+		ENEMY_FLAG,
+		OWN_SCORE_LOCATION,
+		ENEMY_SCORE_LOCATION,
+		TARGET_COUNT,
+	};
+
+	DistanceFieldCache() : m_Grid(NULL)
+	{
+		reset();
+	}
+
+	/**
+	* Fields are searched over the free cells of the grid, which must outlive the cache.
+	*/
+	void init(const SpatialGrid& grid)
+	{
+		m_Grid = &grid;
+		reset();
+	}
+
+	/**
+	* Takes the targets of the tick, the fields of those which moved to another cell are searched again when read.
+	* Must not run while the fields are read.
+	*/
+	void update(const WorldSnapshot& world)
+	{
+		updateTarget(OWN_FLAG, world.getOwnFlag());
+		updateTarget(ENEMY_FLAG, world.getEnemyFlag());
+		updateTarget(OWN_SCORE_LOCATION, world.getOwnScoreLocation());
+		updateTarget(ENEMY_SCORE_LOCATION, world.getEnemyScoreLocation());
+	}
+
+	const DistanceField& get(Target target) const
+	{
+		Entry& entry = m_Entries[target];
+		boost::lock_guard<boost::mutex> lock(entry.m_Lock);
+		if (entry.m_Dirty)
+		{
+			assert(m_Grid != NULL);
+			entry.m_Field.build(*m_Grid, vector<Vector2>(1, entry.m_Position));
+			entry.m_Dirty = false;
+			entry.m_BuildCount++;
+		}
+		return entry.m_Field;
+	}
+
+	/**
+	* Number of fields searched so far, to see how often the cache is missed.
+	*/
+	size_t getBuildCount() const
+	{
+		size_t count = 0;
+		for (int i = 0; i < TARGET_COUNT; i++)
+		{
+			boost::lock_guard<boost::mutex> lock(m_Entries[i].m_Lock);
+			count += m_Entries[i].m_BuildCount;
+		}
+		return count;
+	}
+
+private:
+	struct Entry
+	{
+		DistanceField m_Field;
+		boost::mutex m_Lock;
+
+		/**
+		* Target and cell the field is for, the cell is -1 before the first update.
+		*/
+		Vector2 m_Position;
+		int m_Cell[2];
+		bool m_Dirty;
+		size_t m_BuildCount;
+	};
+
+	const SpatialGrid* m_Grid;
+	mutable Entry m_Entries[TARGET_COUNT];
+
+	void reset()
+	{
+		for (int i = 0; i < TARGET_COUNT; i++)
+		{
+			m_Entries[i].m_Cell[0] = m_Entries[i].m_Cell[1] = -1;
+			m_Entries[i].m_Dirty = false;
+			m_Entries[i].m_BuildCount = 0;
+		}
+	}
+
+	void updateTarget(Target target, const Vector2& position)
+	{
+		Entry& entry = m_Entries[target];
+		int x = (int)floor(position.x);
+		int y = (int)floor(position.y);
+		if (x == entry.m_Cell[0] && y == entry.m_Cell[1])
+		{
+			return;
+		}
+		entry.m_Cell[0] = x;
+		entry.m_Cell[1] = y;
+		entry.m_Position = position;
+		entry.m_Dirty = true;
+	}
+};
+
+#endif // !defined (DISTANCE_FIELD_H)
@@ -3,27 +3,22 @@
 #include <boost/thread.hpp>
 #include <map>
 #include <cassert>
+#include <cstdlib>
+#include <iostream>
 
-#include "../../api/GameInfo.h"
-#include "../../api/Commands.h"
-#include "../../api/Commander.h"
 #include "../../api/CommanderFactory.h"
-//#include "StrategyPlaner.hpp"
+#include "CommandPool.hpp"
+#include "HartCommander.h"
 
 using namespace std;
 
-class HartCommander : public Commander
-{
-public:
-    virtual string getName() const;
-    virtual void initialize();
-    virtual void tick();
-    virtual void shutdown();
+REGISTER_COMMANDER(HartCommander);
 
-	map<string, bool> m_botAliveState;
-};
 
-REGISTER_COMMANDER(HartCommander);
+HartCommander::HartCommander()
+	: m_matchSeed(0), m_matchSeedGiven(false), m_dumpInstrumentation(false), m_sink(NULL)
+{
+}
 
 
 string
@@ -38,11 +33,45 @@ void
 HartCommander::initialize()
 {
     // Use this function to setup your bot before the game starts.
-	for (auto iter = m_game->bots.begin(); iter != m_game->bots.end(); ++iter)
+	// The seed of a recorded match can be given to replay it.
+	const char* seed = getenv("HART_MATCH_SEED");
+	if (seed != NULL && !m_matchSeedGiven)
 	{
-		const BotInfo& bot = *iter->second;
-		m_botAliveState[bot.name] = false;
+		m_matchSeed = strtoull(seed, NULL, 10);
 	}
+	// Logged so that any match can be replayed, whether the seed was given or not.
+	clog << getName() << ": match seed " << m_matchSeed << " (replay with HART_MATCH_SEED=" << m_matchSeed << ")" << endl;
+	// Any value other than 0 turns on the latency instrumentation and dumps it at shutdown.
+	const char* instrument = getenv("HART_INSTRUMENT");
+	if (instrument != NULL)
+	{
+		m_dumpInstrumentation = string(instrument) != "0";
+		m_instrumentation.setEnabled(m_dumpInstrumentation);
+	}
+	// Descriptions only help debugging, batches leave them out unless asked for.
+	const char* descriptions = getenv("HART_COMMAND_DESCRIPTIONS");
+	m_batch.setDescriptions(descriptions != NULL && string(descriptions) != "0");
+
+	m_bots.init(*m_game);
+	m_world = WorldSnapshot();
+	m_gate.reset(m_bots.size());
+
+	m_planer.reset(new StrategyPlaner(*m_game, *m_level, m_bots, m_matchSeed));
+	// Bots start from the profiles learned in earlier matches, kept in the given file.
+	const char* profiles = getenv("HART_PROFILES");
+	if (profiles != NULL)
+	{
+		if (m_profileStore.open(profiles))
+		{
+			m_planer->setProfileLibrary(&m_profileStore);
+		}
+		else
+		{
+			clog << getName() << ": cannot read the profiles in " << profiles << ", playing without them" << endl;
+		}
+	}
+	m_planer->init();
+	m_planer->setInstrumentation(&m_instrumentation);
 }
 
 
@@ -56,62 +85,64 @@ HartCommander::tick()
     // Warning: don't spam commands. It will probably not have the effect you want as bots 
     // pause their behavior each time they get a new command.
 
-	/*StrategyPlaner planer(*m_game, *m_level);
-	planer.init();
-	vector<unique_ptr<const Command>> commands = planer.tick();
+	ScopedTimer timer(m_instrumentation.timer(Instrumentation::STAGE_COMMANDER));
+	m_instrumentation.count(Instrumentation::COUNTER_TICKS);
 
-	for (auto i = commands.begin(); i != commands.end() ; i++)
+	// Built once, every bot decides on the same copy of the world.
+	m_world.build(*m_game, *m_level, m_bots);
+
+	// Only the events added since the last tick are processed, whether bots are alive is up to the world.
+	const vector<MatchCombatEvent>& events = m_world.getEvents();
+	bool respawned = false;
+	for (size_t i = m_world.getFirstNewEvent(); i < m_world.getEndEvent() && !respawned; ++i)
 	{
-		issue(*i);
-	}*/
+		respawned = events[i].type == MatchCombatEvent::TYPE_RESPAWN;
+	}
 
 	//"""Process all the bots that are done with their orders and available for taking commands."""
+	m_planer->tick(m_world, m_commands);
+	// Bots which are idle or dead have no order left, their next command always goes out.
+	m_gate.update(m_world);
+	size_t suppressed = m_gate.filter(m_world.getTimePassed(), m_planer->getCommandBots(), m_commands);
+	m_instrumentation.count(Instrumentation::COUNTER_SUPPRESSED, suppressed);
+	m_instrumentation.count(Instrumentation::COUNTER_COMMANDS, m_gate.getCommands().size());
 
-	// The 'bots_available' list is a dynamically calculated list of bots that are done with their commands.
-	for (auto i = m_game->bots_available.begin(), end = m_game->bots_available.end(); i!=end; ++i)
+	flushCommands();
+
+	// The weights learn once per respawn wave, after the commands of this tick went out.
+	if (respawned)
 	{
-		// Determine a place to run randomly...
-		Vector2 target;
-		switch((int)((float)rand()/RAND_MAX*3))
-		{
-		case 0: // Either a random choice of *current* flag locations, ours or theirs.
-			target = (((float)rand()/RAND_MAX > 0.5f) ? m_game->team:m_game->enemyTeam)->flag->position;
-			break;
-
-		case 1: // Or a random choice of the goal locations for returning flags.
-			target = (((float)rand()/RAND_MAX > 0.5f) ? m_game->team:m_game->enemyTeam)->flagScoreLocation;
-			break; 
-
-		case 2: // Or a random position in the entire level, one that's not blocked.
-			target = *(*i)->position;
-			m_level->findRandomFreePositionInBox(target, Vector2(0.0f,0.0f), Vector2((float)m_level->width, (float)m_level->height));
-			break;
-		}
+		m_planer->applyRewards();
+	}
+}
+
 
-		switch((int)((float)rand()/RAND_MAX*2))
+void
+HartCommander::flushCommands()
+{
+	const vector<const Command*>& commands = m_gate.getCommands();
+	const vector<BotId>& bots = m_gate.getBots();
+	if (m_sink == NULL)
+	{
+		for (size_t i = 0; i < commands.size(); ++i)
 		{
-		case 0: issue(new AttackCommand((*i)->name, target, boost::none, "random")); break;
-		case 1: issue(new ChargeCommand((*i)->name, target, "random")); break;
+			// The server takes ownership of issued commands, so they leave the planer's pool.
+			issue(m_planer->releaseCommand(bots[i], *commands[i]));
 		}
+		return;
 	}
 
-	for (auto iter = m_game->match->combatEvents.begin(); iter != m_game->match->combatEvents.end(); ++iter)
+	ScopedTimer timer(m_instrumentation.timer(Instrumentation::STAGE_FLUSH));
+	m_batch.clear();
+	for (size_t i = 0; i < commands.size(); ++i)
 	{
-		const MatchCombatEvent& event = *iter;
-		if (event.type == MatchCombatEvent::TYPE_RESPAWN)
-		{
-			m_botAliveState[event.respawnEventData.subject->name] = true;
-		}
-		else if (event.type == MatchCombatEvent::TYPE_KILLED)
+		if (!m_batch.add(bots[i], *commands[i]))
 		{
-			m_botAliveState[event.killedEventData.subject->name] = false;
+			assert(false && "Command kind not handled by the batch");
 		}
 	}
-	for (auto iter = m_game->team->members.begin(); iter != m_game->team->members.end(); ++iter)
-	{
-		const BotInfo& bot = **iter;
-		assert(m_botAliveState[bot.name] == *bot.health > 0);
-	}
+	m_instrumentation.count(Instrumentation::COUNTER_BYTES, m_batch.getByteSize());
+	m_sink->flush(m_batch);
 }
 
 
@@ -119,5 +150,20 @@ void
 HartCommander::shutdown()
 {
     // Use this function to do stuff after the game finishes.
+	// The outcome of the match rewards the DMS every bot ended it with.
+	int score = m_game->match->scores[m_game->team->name];
+	int enemyScore = m_game->match->scores[m_game->enemyTeam->name];
+	m_planer->reward(score > enemyScore ? 1.0f : (score < enemyScore ? -1.0f : 0.0f));
+	m_planer->applyRewards();
+
+	if (m_profileStore.isOpen())
+	{
+		m_planer->saveProfiles();
+		m_profileStore.flush();
+	}
+	if (m_dumpInstrumentation)
+	{
+		m_instrumentation.dump(cout);
+	}
 }
 
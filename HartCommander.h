@@ -0,0 +1,110 @@
+#ifndef HART_COMMANDER_H
+#define HART_COMMANDER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "../../api/GameInfo.h"
+#include "../../api/Commands.h"
+#include "../../api/Commander.h"
+#include "CommandBatch.hpp"
+#include "CommandGate.hpp"
+#include "BotRegistry.hpp"
+#include "StrategyPlaner.hpp"
+#include "WorldSnapshot.hpp"
+#include "ProfileStore.h"
+#include "tools/Instrumentation.h"
+
+using namespace std;
+
+class HartCommander : public Commander
+{
+public:
+    HartCommander();
+
+    virtual string getName() const;
+    virtual void initialize();
+    virtual void tick();
+    virtual void shutdown();
+
+	/**
+	* Sends the commands of every tick as one batch to the given sink instead of issuing them one by one.
+	* NULL goes back to issue().
+	*/
+	void setCommandSink(CommandSink* sink) { m_sink = sink; }
+
+	/**
+	* Seed of the next match, given before initialize() it wins over HART_MATCH_SEED.
+	*/
+	void setMatchSeed(boost::uint64_t seed)
+	{
+		m_matchSeed = seed;
+		m_matchSeedGiven = true;
+	}
+
+	/**
+	* Seed the match is played with, logged at initialize().
+	*/
+	boost::uint64_t getMatchSeed() const { return m_matchSeed; }
+
+	/**
+	* Enabled by HART_INSTRUMENT, or by hand before initialize() to read the latencies after the match.
+	*/
+	Instrumentation& getInstrumentation() { return m_instrumentation; }
+
+	const StrategyPlaner* getPlaner() const { return m_planer.get(); }
+
+	/**
+	* Dense ids of all bots of the match, per-bot state is indexed by them.
+	*/
+	BotRegistry m_bots;
+
+	/**
+	* State of the world for the current tick, every decision is made on it.
+	*/
+	WorldSnapshot m_world;
+
+	/**
+	* Seed of the match, every bot draws from its own stream derived from it.
+	* Replaying a match with the same seed reproduces all random decisions.
+	*/
+	boost::uint64_t m_matchSeed;
+	bool m_matchSeedGiven;
+
+	/**
+	* Lives for the whole match and keeps the decision stack of every bot.
+	*/
+	unique_ptr<StrategyPlaner> m_planer;
+
+	/**
+	* Commands of the current tick, reused across ticks.
+	*/
+	vector<const Command*> m_commands;
+
+	/**
+	* Drops the commands of the tick which would only interrupt the current order of their bot.
+	*/
+	CommandGate m_gate;
+
+	/**
+	* Latencies of the pipeline, dumped at shutdown.
+	*/
+	Instrumentation m_instrumentation;
+	bool m_dumpInstrumentation;
+
+	/**
+	* Batch of the current tick and where it is flushed to, NULL to issue the commands instead.
+	*/
+	CommandBatch m_batch;
+	CommandSink* m_sink;
+
+	/**
+	* Profiles of earlier matches, opened from HART_PROFILES and appended to at shutdown.
+	*/
+	dms::ProfileStore m_profileStore;
+
+	void flushCommands();
+};
+
+#endif // !defined (HART_COMMANDER_H)
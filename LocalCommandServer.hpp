@@ -0,0 +1,76 @@
+#ifndef LOCAL_COMMAND_SERVER_H
+#define LOCAL_COMMAND_SERVER_H
+
+#include <vector>
+#include <boost/cstdint.hpp>
+#include "CommandBatch.hpp"
+#include "tools/Instrumentation.h"
+
+using namespace std;
+
+/**
+* In-process stand-in for the game server at the other end of the command channel.
+* Decodes every flushed batch into the current order of each bot and
+* keeps the totals and decode latencies, to measure what the channel costs per tick.
+*/
+class LocalCommandServer : public CommandSink
+{
+private:
+	vector<BatchedCommand> m_Orders;
+	vector<char> m_HasOrder;
+	BatchedCommand m_Command;
+
+	boost::uint64_t m_Flushes;
+	boost::uint64_t m_Commands;
+	boost::uint64_t m_Bytes;
+	LatencyHistogram m_DecodeLatency;
+
+public:
+	LocalCommandServer()
+		: m_Flushes(0), m_Commands(0), m_Bytes(0) {}
+
+	virtual void flush(const CommandBatch& batch)
+	{
+		ScopedTimer timer(&m_DecodeLatency);
+		m_Flushes++;
+		m_Bytes += batch.getByteSize();
+
+		CommandBatch::Reader reader(batch);
+		while (reader.next(m_Command))
+		{
+			BotId id = m_Command.m_BotId;
+			if (id >= m_Orders.size())
+			{
+				m_Orders.resize(id + 1);
+				m_HasOrder.resize(id + 1, 0);
+			}
+			// Swapping keeps the capacity of both descriptions, m_Command gets the previous order
+			swap(m_Orders[id], m_Command);
+			m_HasOrder[id] = 1;
+			m_Commands++;
+		}
+	}
+
+	/**
+	* Last order the given bot got, NULL if it never got one.
+	*/
+	const BatchedCommand* getOrder(BotId botId) const
+	{
+		return botId < m_Orders.size() && m_HasOrder[botId] ? &m_Orders[botId] : NULL;
+	}
+
+	boost::uint64_t getFlushCount() const { return m_Flushes; }
+	boost::uint64_t getCommandCount() const { return m_Commands; }
+	boost::uint64_t getByteCount() const { return m_Bytes; }
+	const LatencyHistogram& getDecodeLatency() const { return m_DecodeLatency; }
+
+	void reset()
+	{
+		m_Orders.clear();
+		m_HasOrder.clear();
+		m_Flushes = m_Commands = m_Bytes = 0;
+		m_DecodeLatency.reset();
+	}
+};
+
+#endif // !defined (LOCAL_COMMAND_SERVER_H)
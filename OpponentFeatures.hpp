@@ -0,0 +1,264 @@
+#ifndef OPPONENT_FEATURES_H
+#define OPPONENT_FEATURES_H
+
+#include <vector>
+#include <cmath>
+#include <cassert>
+#include "../../api/GameInfo.h"
+#include "DecisionMaking.h"
+#include "WorldSnapshot.hpp"
+
+using namespace dms;
+
+/**
+* Running statistics of the way the opponent plays, the internal features of the profile managers.
+* Every update only processes the new combat events of the world and the enemies seen right now,
+* so it costs the same at the end of a match as at its start. Older observations fade out
+* exponentially, an observation counts half as much after the half-life.
+* Every feature is normalized to [0, 1], so none of them outweighs the others in the distance
+* between two feature vectors, whatever its unit.
+*/
+class OpponentFeatureExtractor
+{
+public:
+	enum
+	{
+		/**
+		* Our bots killed by the opponent per minute, normalized by getRateScale().
+		*/
+		FEATURE_KILL_RATE,
+
+		/**
+		* Our flag picked up by the opponent per minute, normalized by getRateScale().
+		*/
+		FEATURE_FLAG_RUSH_RATE,
+
+		/**
+		* Our flag captured by the opponent per minute, normalized by getRateScale().
+		*/
+		FEATURE_CAPTURE_RATE,
+
+		/**
+		* Mean distance between the killer and our bot, as a fraction of the distance from the enemy spawn area to our flag.
+		* Events carry no positions, so only kills since the last update with our bot still dead are measured,
+		* in the world of the update.
+		*/
+		FEATURE_KILL_DISTANCE,
+
+		/**
+		* Mean progress of the enemies we see from their spawn area, 0, to our flag, 1.
+		*/
+		FEATURE_ADVANCE,
+
+		FEATURE_COUNT,
+	};
+
+	static const char* getFeatureName(int feature)
+	{
+		static const char* names[FEATURE_COUNT] = { "opponentKillRate", "opponentFlagRushRate", "opponentCaptureRate", "opponentKillDistance", "opponentAdvance" };
+		return names[feature];
+	}
+
+	/**
+	* Rate per minute of a rate feature at which it is normalized to one half, typical of a match.
+	* A rate r is normalized to r / (r + scale), so it stays below one however high it gets.
+	*/
+	static float getRateScale(int feature)
+	{
+		static const float scales[] = { 4.0f, 1.0f, 0.5f };
+		assert(feature <= FEATURE_CAPTURE_RATE);
+		return scales[feature];
+	}
+
+	/**
+	* Largest distance between the features of two profiles for them to be the same style.
+	*/
+	static float getSimilarityThreshold() { return 0.2f; }
+
+	OpponentFeatureExtractor(float halfLife = 30.0f)
+		: m_HalfLife(halfLife)
+	{
+		for (int i = 0; i < FEATURE_COUNT; i++)
+		{
+			m_Ids[i] = FeatureSchema::getDefault().intern(getFeatureName(i));
+		}
+		reset();
+	}
+
+	FeatureId getFeatureId(int feature) const { return m_Ids[feature]; }
+
+	/**
+	* Features as of the last update.
+	*/
+	const FeatureVector& getFeatures() const { return m_Features; }
+
+	float getHalfLife() const { return m_HalfLife; }
+
+	static float normalizeRate(int feature, float perMinute) { return perMinute / (perMinute + getRateScale(feature)); }
+
+	/**
+	* Forgets everything observed.
+	*/
+	void reset()
+	{
+		m_LastTime = 0.0f;
+		for (int i = 0; i < FEATURE_COUNT; i++)
+		{
+			m_Sums[i] = 0.0f;
+			m_Weights[i] = 0.0f;
+		}
+		m_Features.clear();
+		for (int i = 0; i < FEATURE_COUNT; i++)
+		{
+			m_Features.set(m_Ids[i], 0.0f);
+		}
+	}
+
+	/**
+	* Takes in the new combat events of the world of this tick and the enemies seen in it.
+	*/
+	void update(const WorldSnapshot& world)
+	{
+		if (world.getTimePassed() < m_LastTime)
+		{
+			// Another match started
+			reset();
+		}
+
+		float last = m_LastTime;
+		float elapsed = world.getTimePassed() - last;
+		m_LastTime = world.getTimePassed();
+		float decay = exp2(-elapsed / m_HalfLife);
+		for (int i = 0; i < FEATURE_COUNT; i++)
+		{
+			m_Sums[i] *= decay;
+			m_Weights[i] *= decay;
+		}
+
+		const vector<MatchCombatEvent>& events = world.getEvents();
+		for (size_t i = world.getFirstNewEvent(); i < world.getEndEvent(); ++i)
+		{
+			addEvent(world, events[i], last);
+		}
+
+		if (elapsed > 0.0f)
+		{
+			observeEnemies(world, elapsed);
+		}
+
+		// A count decayed continuously settles at the rate times the half-life over ln 2
+		float perMinute = 60.0f * log(2.0f) / m_HalfLife;
+		for (int i = FEATURE_KILL_RATE; i <= FEATURE_CAPTURE_RATE; i++)
+		{
+			m_Features.set(m_Ids[i], normalizeRate(i, m_Sums[i] * perMinute));
+		}
+		m_Features.set(m_Ids[FEATURE_KILL_DISTANCE], getMean(FEATURE_KILL_DISTANCE));
+		m_Features.set(m_Ids[FEATURE_ADVANCE], getMean(FEATURE_ADVANCE));
+	}
+
+private:
+	float m_HalfLife;
+	FeatureId m_Ids[FEATURE_COUNT];
+
+	/**
+	* Match time of the last update.
+	*/
+	float m_LastTime;
+
+	/**
+	* Decayed sums of every feature; the means are also divided by their decayed weights.
+	*/
+	float m_Sums[FEATURE_COUNT];
+	float m_Weights[FEATURE_COUNT];
+
+	FeatureVector m_Features;
+
+	float getMean(int feature) const { return m_Weights[feature] > 0.0f ? m_Sums[feature] / m_Weights[feature] : 0.0f; }
+
+	void addSample(int feature, float value, float weight)
+	{
+		m_Sums[feature] += value * weight;
+		m_Weights[feature] += weight;
+	}
+
+	/**
+	* Id of the bot if it is one of the opponent, NO_BOT otherwise.
+	*/
+	BotId getEnemy(const WorldSnapshot& world, const BotInfo* bot) const
+	{
+		BotId id = bot != NULL ? world.getId(*bot) : NO_BOT;
+		return id != NO_BOT && !world.isOwnTeam(id) ? id : NO_BOT;
+	}
+
+	/**
+	* Counts an event of the world, the last update was at the given time.
+	*/
+	void addEvent(const WorldSnapshot& world, const MatchCombatEvent& event, float last)
+	{
+		switch (event.type)
+		{
+		case MatchCombatEvent::TYPE_KILLED:
+		{
+			BotId killer = getEnemy(world, event.killedEventData.instigator);
+			BotId victim = event.killedEventData.subject != NULL ? world.getId(*event.killedEventData.subject) : NO_BOT;
+			if (killer != NO_BOT && victim != NO_BOT && world.isOwnTeam(victim))
+			{
+				m_Sums[FEATURE_KILL_RATE] += 1.0f;
+				// A kill reported late or a bot respawned since is not where the kill happened
+				float length = getLength(world);
+				if (event.time >= last && !world.isAlive(victim) && world.hasPosition(killer) && world.hasPosition(victim) && length > 0.0f)
+				{
+					addSample(FEATURE_KILL_DISTANCE, min(1.0f, world.getPosition(killer).distance(world.getPosition(victim)) / length), 1.0f);
+				}
+			}
+			break;
+		}
+		case MatchCombatEvent::TYPE_FLAG_PICKEDUP:
+			if (getEnemy(world, event.flagPickedupEventData.instigator) != NO_BOT && world.isOwnFlag(event.flagPickedupEventData.subject))
+			{
+				m_Sums[FEATURE_FLAG_RUSH_RATE] += 1.0f;
+			}
+			break;
+		case MatchCombatEvent::TYPE_FLAG_CAPTURED:
+			if (getEnemy(world, event.flagCapturedEventData.instigator) != NO_BOT && world.isOwnFlag(event.flagCapturedEventData.subject))
+			{
+				m_Sums[FEATURE_CAPTURE_RATE] += 1.0f;
+			}
+			break;
+		}
+	}
+
+	/**
+	* Distance from the center of the enemy spawn area to our flag, the length distances are measured in.
+	*/
+	static float getLength(const WorldSnapshot& world)
+	{
+		const pair<Vector2, Vector2>& area = world.getEnemySpawnArea();
+		Vector2 spawn = (area.first + area.second) * 0.5f;
+		return spawn.distance(world.getOwnFlagSpawnLocation());
+	}
+
+	/**
+	* Samples the progress of the enemies seen by our bots, weighted by the time since the last update.
+	*/
+	void observeEnemies(const WorldSnapshot& world, float elapsed)
+	{
+		const Vector2& target = world.getOwnFlagSpawnLocation();
+		float length = getLength(world);
+		if (length <= 0.0f)
+		{
+			return;
+		}
+
+		for (BotId id = 0; id < world.getBotCount(); id++)
+		{
+			if (!world.isOwnTeam(id) && world.isSeen(id) && world.hasPosition(id))
+			{
+				float progress = 1.0f - world.getPosition(id).distance(target) / length;
+				addSample(FEATURE_ADVANCE, max(0.0f, min(1.0f, progress)), elapsed);
+			}
+		}
+	}
+};
+
+#endif // !defined (OPPONENT_FEATURES_H)
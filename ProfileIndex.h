@@ -0,0 +1,346 @@
+#ifndef PROFILE_INDEX_H
+#define PROFILE_INDEX_H
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cassert>
+
+using namespace std;
+
+namespace dms{
+
+	/**
+	* Best match of a nearest profile search.
+	*/
+	struct ProfileMatch
+	{
+		ProfileMatch() : m_Index(NO_MATCH), m_Distance(numeric_limits<float>::max()) {}
+
+		static const size_t NO_MATCH = ~(size_t)0;
+
+		size_t m_Index;
+
+		/**
+		* Euclidean distance between the query and the match.
+		*/
+		float m_Distance;
+
+		bool found() const { return m_Index != NO_MATCH; }
+	};
+
+	/**
+	* Nearest neighbour index over the feature vectors of profiles, all of the same dimension.
+	* Vectors are kept in one contiguous array, every row padded with zeros to a multiple of
+	* four floats so the distance kernel runs over whole blocks the compiler can vectorize.
+	*
+	* Small or high dimensional sets are searched brute force, otherwise through a k-d tree.
+	* Vectors added after the last build() are searched brute force until the next build.
+	*/
+	class ProfileIndex
+	{
+	public:
+		enum
+		{
+			LEAF_SIZE = 8,
+
+			/**
+			* Below this many vectors a scan is faster than the tree.
+			*/
+			BRUTE_FORCE_SIZE = 64,
+
+			/**
+			* Above this many dimensions a k-d tree prunes too little to pay off.
+			*/
+			MAX_TREE_DIMENSION = 16,
+		};
+
+		ProfileIndex(size_t dimension = 0)
+			: m_Dimension(dimension), m_Stride(strideOf(dimension)), m_Count(0), m_Built(0) {}
+
+		size_t getDimension() const { return m_Dimension; }
+		size_t size() const { return m_Count; }
+
+		/**
+		* Vectors added since the last build().
+		*/
+		size_t getUnindexedCount() const { return size() - m_Built; }
+
+		/**
+		* Grows the dimension, existing vectors are padded with zeros, i.e. they lack the new features.
+		* Drops the tree.
+		*/
+		void setDimension(size_t dimension)
+		{
+			assert(dimension >= m_Dimension);
+			size_t count = size();
+			size_t stride = strideOf(dimension);
+			if (stride != m_Stride)
+			{
+				vector<float> points(count * stride, 0.0f);
+				for (size_t i = 0; i < count; i++)
+				{
+					copy(m_Points.begin() + i * m_Stride, m_Points.begin() + i * m_Stride + m_Dimension, points.begin() + i * stride);
+				}
+				m_Points.swap(points);
+			}
+			m_Dimension = dimension;
+			m_Stride = stride;
+			clearTree();
+		}
+
+		void clear()
+		{
+			m_Points.clear();
+			m_Count = 0;
+			clearTree();
+		}
+
+		/**
+		* Adds a vector of the index dimension, returns its index.
+		*/
+		size_t add(const float* point)
+		{
+			size_t index = size();
+			m_Points.insert(m_Points.end(), point, point + m_Dimension);
+			m_Points.resize(m_Points.size() + m_Stride - m_Dimension, 0.0f);
+			m_Count = index + 1;
+			return index;
+		}
+
+		const float* getPoint(size_t index) const { return &m_Points[index * m_Stride]; }
+
+		/**
+		* Builds the k-d tree over all vectors, if the set is one worth a tree.
+		*/
+		void build()
+		{
+			clearTree();
+			size_t count = size();
+			m_Built = count;
+			if (count <= BRUTE_FORCE_SIZE || m_Dimension == 0 || m_Dimension > MAX_TREE_DIMENSION)
+			{
+				return;
+			}
+
+			m_Order.resize(count);
+			for (size_t i = 0; i < count; i++)
+			{
+				m_Order[i] = i;
+			}
+			m_Nodes.reserve(2 * count / LEAF_SIZE + 1);
+			buildNode(0, count);
+
+			// Leaves scan their vectors in tree order, so they are stored in tree order too
+			m_TreePoints.resize(count * m_Stride);
+			for (size_t i = 0; i < count; i++)
+			{
+				copy(m_Points.begin() + m_Order[i] * m_Stride, m_Points.begin() + (m_Order[i] + 1) * m_Stride, m_TreePoints.begin() + i * m_Stride);
+			}
+		}
+
+		/**
+		* Nearest vector to the query, which has the index dimension.
+		* Searches share a buffer for the padded query, so one index is searched by one thread at a time.
+		*/
+		ProfileMatch findNearest(const float* query) const
+		{
+			ProfileMatch match;
+			float best = numeric_limits<float>::max();
+			const float* padded = pad(query);
+			if (m_Nodes.empty())
+			{
+				scan(padded, 0, size(), best, match);
+			} else
+			{
+				searchNode(0, padded, best, match);
+				scan(padded, m_Built, size(), best, match);
+			}
+			match.m_Distance = match.found() ? sqrt(best) : best;
+			return match;
+		}
+
+		/**
+		* Nearest vector by comparing all of them, the reference for findNearest().
+		*/
+		ProfileMatch findNearestBruteForce(const float* query) const
+		{
+			ProfileMatch match;
+			float best = numeric_limits<float>::max();
+			scan(pad(query), 0, size(), best, match);
+			match.m_Distance = match.found() ? sqrt(best) : best;
+			return match;
+		}
+
+		/**
+		* Squared distance of two rows of the given stride, a multiple of four.
+		* Four independent sums let the loop run as one vector of four lanes.
+		*/
+		static float squaredDistance(const float* a, const float* b, size_t stride)
+		{
+			float sum0 = 0.0f, sum1 = 0.0f, sum2 = 0.0f, sum3 = 0.0f;
+			for (size_t i = 0; i < stride; i += 4)
+			{
+				float d0 = a[i] - b[i];
+				float d1 = a[i + 1] - b[i + 1];
+				float d2 = a[i + 2] - b[i + 2];
+				float d3 = a[i + 3] - b[i + 3];
+				sum0 += d0 * d0;
+				sum1 += d1 * d1;
+				sum2 += d2 * d2;
+				sum3 += d3 * d3;
+			}
+			return (sum0 + sum1) + (sum2 + sum3);
+		}
+
+	private:
+		struct Node
+		{
+			size_t m_Begin;
+			size_t m_End;
+			size_t m_Left;
+			size_t m_Right;
+			size_t m_Axis;
+			float m_Split;
+
+			bool isLeaf() const { return m_Left == 0; }
+		};
+
+		size_t m_Dimension;
+		size_t m_Stride;
+		size_t m_Count;
+		vector<float> m_Points;
+
+		/**
+		* Tree over the first m_Built vectors, their indices in tree order and a copy of them in that order.
+		*/
+		size_t m_Built;
+		vector<Node> m_Nodes;
+		vector<size_t> m_Order;
+		vector<float> m_TreePoints;
+
+		/**
+		* Query of the last search padded to the stride, kept to reuse its memory.
+		*/
+		mutable vector<float> m_Query;
+
+		static size_t strideOf(size_t dimension) { return (dimension + 3) & ~(size_t)3; }
+
+		const float* pad(const float* query) const
+		{
+			m_Query.assign(query, query + m_Dimension);
+			m_Query.resize(m_Stride, 0.0f);
+			return m_Query.data();
+		}
+
+		void clearTree()
+		{
+			m_Nodes.clear();
+			m_Order.clear();
+			m_TreePoints.clear();
+			m_Built = 0;
+		}
+
+		/**
+		* Splits the range at the median of its widest axis until it fits a leaf.
+		*/
+		size_t buildNode(size_t begin, size_t end)
+		{
+			size_t index = m_Nodes.size();
+			Node node;
+			node.m_Begin = begin;
+			node.m_End = end;
+			node.m_Left = node.m_Right = 0;
+			node.m_Axis = 0;
+			node.m_Split = 0.0f;
+			m_Nodes.push_back(node);
+			if (end - begin <= LEAF_SIZE)
+			{
+				return index;
+			}
+
+			float widest = -1.0f;
+			for (size_t axis = 0; axis < m_Dimension; axis++)
+			{
+				float low = numeric_limits<float>::max();
+				float high = -numeric_limits<float>::max();
+				for (size_t i = begin; i < end; i++)
+				{
+					float value = m_Points[m_Order[i] * m_Stride + axis];
+					low = min(low, value);
+					high = max(high, value);
+				}
+				if (high - low > widest)
+				{
+					widest = high - low;
+					node.m_Axis = axis;
+				}
+			}
+			if (widest <= 0.0f)
+			{
+				// All vectors are equal
+				return index;
+			}
+
+			size_t middle = begin + (end - begin) / 2;
+			size_t axis = node.m_Axis;
+			const vector<float>& points = m_Points;
+			size_t stride = m_Stride;
+			nth_element(m_Order.begin() + begin, m_Order.begin() + middle, m_Order.begin() + end,
+				[&points, stride, axis](size_t a, size_t b) { return points[a * stride + axis] < points[b * stride + axis]; });
+			node.m_Split = m_Points[m_Order[middle] * m_Stride + axis];
+
+			node.m_Left = buildNode(begin, middle);
+			node.m_Right = buildNode(middle, end);
+			m_Nodes[index] = node;
+			return index;
+		}
+
+		void searchNode(size_t index, const float* query, float& best, ProfileMatch& match) const
+		{
+			const Node& node = m_Nodes[index];
+			if (node.isLeaf())
+			{
+				for (size_t i = node.m_Begin; i < node.m_End; i++)
+				{
+					float distance = squaredDistance(query, &m_TreePoints[i * m_Stride], m_Stride);
+					if (distance < best)
+					{
+						best = distance;
+						match.m_Index = m_Order[i];
+					}
+				}
+				return;
+			}
+
+			float offset = query[node.m_Axis] - node.m_Split;
+			size_t nearSide = offset < 0.0f ? node.m_Left : node.m_Right;
+			size_t farSide = offset < 0.0f ? node.m_Right : node.m_Left;
+			searchNode(nearSide, query, best, match);
+			if (offset * offset < best)
+			{
+				searchNode(farSide, query, best, match);
+			}
+		}
+
+		/**
+		* Brute force over the vectors in [begin, end).
+		*/
+		void scan(const float* query, size_t begin, size_t end, float& best, ProfileMatch& match) const
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				float distance = m_Stride > 0 ? squaredDistance(query, &m_Points[i * m_Stride], m_Stride) : 0.0f;
+				if (distance < best)
+				{
+					best = distance;
+					match.m_Index = i;
+				}
+			}
+		}
+	};
+
+}
+
+#endif // !defined (PROFILE_INDEX_H)
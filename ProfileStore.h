@@ -0,0 +1,504 @@
+#ifndef PROFILE_STORE_H
+#define PROFILE_STORE_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <cassert>
+#include <boost/cstdint.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/sync/file_lock.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include "DecisionMaking.h"
+
+using namespace std;
+
+namespace dms{
+
+	/**
+	* Profile library in a compact, versioned binary file.
+	* The file is memory-mapped when opened; only the offset of every profile is read then,
+	* a profile is decoded when it is loaded. Profiles added during a session are kept in memory
+	* and appended to the file with flush(), at the end of the session.
+	* Sessions may share the file, from one process or several: a flush reads the records other
+	* sessions appended since it was opened and appends after them, under a lock of the file.
+	*
+	* The file is a header followed by records:
+	*   header   uint32 MAGIC, uint16 VERSION, uint16 reserved
+	*   name     uint8 RECORD_NAME, uint8 length, chars
+	*            interns the next feature id, a name comes before the first profile using it
+	*   profile  uint8 RECORD_PROFILE, uint8 connection count, uint16 feature count,
+	*            per feature uint16 id and float32 value, per connection int32 weight
+	*            features which are zero are left out
+	* All integers, and the bits of floats, are little endian. A record cut short, e.g. by a crash
+	* while appending, ends the file; the next flush overwrites it and cuts off what is left of it.
+	* Version 1 stored int32 feature values. Such files are read as well, and converted to the current
+	* version by the first flush.
+	*/
+	class ProfileStore : public ProfileLibrary
+	{
+	public:
+		enum
+		{
+			MAGIC = 0x46525048, // "HPRF"
+			VERSION = 2,
+			VERSION_INT_FEATURES = 1,
+			HEADER_SIZE = 8,
+			RECORD_NAME = 1,
+			RECORD_PROFILE = 2,
+		};
+
+		ProfileStore() : m_Version(VERSION), m_ValidSize(0) {}
+
+		/**
+		* Maps the file at the given path, which is created if it does not exist.
+		* Returns false if it cannot be read or has another format or an unknown version.
+		*/
+		bool open(const string& path)
+		{
+			close();
+			m_Path = path;
+
+			{
+				// Creates the file with its header if needed
+				fstream file(path.c_str(), ios::in | ios::out | ios::binary | ios::app);
+				if (!file)
+				{
+					return false;
+				}
+				file.seekg(0, ios::end);
+				if (file.tellg() == streampos(0))
+				{
+					vector<boost::uint8_t> header;
+					writeUInt32(header, MAGIC);
+					writeUInt16(header, VERSION);
+					writeUInt16(header, 0);
+					file.write((const char*)&header[0], header.size());
+				}
+			}
+
+			try
+			{
+				boost::interprocess::file_mapping mapping(path.c_str(), boost::interprocess::read_only);
+				boost::interprocess::mapped_region region(mapping, boost::interprocess::read_only);
+				m_Region.swap(region);
+			}
+			catch (const boost::interprocess::interprocess_exception&)
+			{
+				close();
+				return false;
+			}
+
+			if (!scan())
+			{
+				close();
+				return false;
+			}
+			return true;
+		}
+
+		void close()
+		{
+			boost::interprocess::mapped_region empty;
+			m_Region.swap(empty);
+			m_Offsets.clear();
+			m_Schema.clear();
+			m_DefaultIds.clear();
+			m_Pending.clear();
+			m_ValidSize = 0;
+		}
+
+		bool isOpen() const { return m_Region.get_address() != NULL; }
+
+		/**
+		* Version of the open file.
+		*/
+		int getVersion() const { return m_Version; }
+
+		/**
+		* Number of profiles in the file, pending ones excluded.
+		*/
+		virtual size_t size() const { return m_Offsets.size(); }
+
+		size_t getPendingCount() const { return m_Pending.size(); }
+
+		const FeatureSchema& getSchema() const { return m_Schema; }
+
+		virtual void load(size_t index, Profile& profile, WeightMatrix& weights) const
+		{
+			assert(index < m_Offsets.size());
+			const boost::uint8_t* record = getData() + m_Offsets[index];
+			size_t connections = record[1];
+			const boost::uint8_t* values = record + 4 + readUInt16(record + 2) * 6;
+
+			profile.init(weights);
+			loadFeatures(index, profile.getFeatures());
+
+			for (size_t i = 0; i < connections && i < profile.getDecisionMakerCount(); i++, values += 4)
+			{
+				profile.setWeight(i, (int)readUInt32(values));
+			}
+			profile.selectBestDecisionMaker();
+		}
+
+		virtual void loadFeatures(size_t index, FeatureVector& features) const
+		{
+			assert(index < m_Offsets.size());
+			const boost::uint8_t* record = getData() + m_Offsets[index];
+			size_t count = readUInt16(record + 2);
+			const boost::uint8_t* values = record + 4;
+
+			features.clear();
+			for (size_t i = 0; i < count; i++, values += 6)
+			{
+				features.set(m_DefaultIds[readUInt16(values)], readValue(values + 2));
+			}
+		}
+
+		/**
+		* Keeps the profile to be appended with the next flush().
+		*/
+		virtual void add(Profile& profile)
+		{
+			const FeatureVector& features = profile.getFeatures();
+			assert(profile.getDecisionMakerCount() <= 0xFF);
+
+			m_Pending.push_back(PendingProfile());
+			PendingProfile& pending = m_Pending.back();
+			for (size_t id = 0; id < features.size(); id++)
+			{
+				float value = features.get((FeatureId)id);
+				if (value != 0.0f)
+				{
+					pending.m_Features.push_back(make_pair((FeatureId)id, value));
+				}
+			}
+			assert(pending.m_Features.size() <= 0xFFFF);
+			for (size_t i = 0; i < profile.getDecisionMakerCount(); i++)
+			{
+				pending.m_Weights.push_back(profile.getWeight(i));
+			}
+		}
+
+		/**
+		* Appends the pending profiles to the file, after the records other sessions appended meanwhile,
+		* and maps it again. The profiles stay pending if they could not be written.
+		*/
+		bool flush()
+		{
+			if (m_Pending.empty())
+			{
+				return true;
+			}
+			if (!isOpen())
+			{
+				return false;
+			}
+
+			// Opening the file again drops the pending profiles, they are put back if writing failed
+			vector<PendingProfile> pending;
+			pending.swap(m_Pending);
+			string path = m_Path;
+			bool written = write(path, pending);
+			bool opened = open(path);
+			if (!written)
+			{
+				m_Pending.swap(pending);
+			}
+			return written && opened;
+		}
+
+		/**
+		* File locked while flushing to the file at the given path. A lock of the data file itself
+		* would be released by closing any handle to it, which mapping it again does.
+		*/
+		static string getLockPath(const string& path) { return path + ".lock"; }
+
+	private:
+		string m_Path;
+		boost::interprocess::mapped_region m_Region;
+		int m_Version;
+
+		/**
+		* Offset of every profile record in the mapped file.
+		*/
+		vector<size_t> m_Offsets;
+
+		/**
+		* Names in the order of the file, and the id of each of them in the default schema.
+		*/
+		FeatureSchema m_Schema;
+		vector<FeatureId> m_DefaultIds;
+
+		/**
+		* Size of the file up to the last complete record.
+		*/
+		size_t m_ValidSize;
+
+		/**
+		* Profile added since the last flush, its features under their ids in the default schema.
+		*/
+		struct PendingProfile
+		{
+			vector<pair<FeatureId, float> > m_Features;
+			vector<int> m_Weights;
+		};
+		vector<PendingProfile> m_Pending;
+
+		static boost::mutex& getFlushMutex()
+		{
+			static boost::mutex mutex;
+			return mutex;
+		}
+
+		const boost::uint8_t* getData() const { return (const boost::uint8_t*)m_Region.get_address(); }
+
+		/**
+		* Writes the profiles after the last complete record of the file at the given path, under its lock.
+		* Whatever followed that record, e.g. a longer torn one, is cut off.
+		*/
+		bool write(const string& path, const vector<PendingProfile>& pending)
+		{
+			try
+			{
+				// The file lock only keeps other processes out
+				boost::lock_guard<boost::mutex> guard(getFlushMutex());
+				string lockPath = getLockPath(path);
+				{
+					fstream create(lockPath.c_str(), ios::out | ios::app);
+				}
+				boost::interprocess::file_lock fileLock(lockPath.c_str());
+				boost::interprocess::scoped_lock<boost::interprocess::file_lock> lock(fileLock);
+
+				// Maps what was appended since the file was opened, the pending profiles are encoded
+				// with the names of the file as it is now
+				if (!open(path))
+				{
+					return false;
+				}
+				vector<boost::uint8_t> records;
+				size_t offset = m_ValidSize;
+				if (m_Version != VERSION)
+				{
+					// Written over as a whole, the converted records take as many bytes as the old ones
+					convert(records);
+					offset = 0;
+				}
+				for (auto iter = pending.begin(); iter != pending.end(); ++iter)
+				{
+					encode(*iter, records);
+				}
+
+				// The mapping is dropped before writing, the records go where the last complete one ended
+				close();
+				{
+					fstream file(path.c_str(), ios::in | ios::out | ios::binary);
+					if (!file)
+					{
+						return false;
+					}
+					file.seekp(offset);
+					file.write((const char*)&records[0], records.size());
+					if (!file)
+					{
+						return false;
+					}
+				}
+				boost::filesystem::resize_file(path, offset + records.size());
+			}
+			catch (const boost::interprocess::interprocess_exception&)
+			{
+				return false;
+			}
+			catch (const boost::filesystem::filesystem_error&)
+			{
+				return false;
+			}
+			return true;
+		}
+
+		/**
+		* Reads the header and the offsets of all profiles, interning the names on the way.
+		*/
+		bool scan()
+		{
+			const boost::uint8_t* data = getData();
+			size_t size = m_Region.get_size();
+			if (size < HEADER_SIZE || readUInt32(data) != MAGIC)
+			{
+				return false;
+			}
+			m_Version = readUInt16(data + 4);
+			if (m_Version != VERSION && m_Version != VERSION_INT_FEATURES)
+			{
+				return false;
+			}
+
+			size_t offset = HEADER_SIZE;
+			m_ValidSize = offset;
+			while (offset < size)
+			{
+				const boost::uint8_t* record = data + offset;
+				size_t remaining = size - offset;
+				size_t length;
+				if (record[0] == RECORD_NAME && remaining >= 2)
+				{
+					length = 2 + record[1];
+					if (length > remaining)
+					{
+						break;
+					}
+					internName(string((const char*)record + 2, record[1]));
+				} else if (record[0] == RECORD_PROFILE && remaining >= 4)
+				{
+					length = 4 + readUInt16(record + 2) * 6 + record[1] * 4;
+					if (length > remaining)
+					{
+						break;
+					}
+					m_Offsets.push_back(offset);
+				} else
+				{
+					break;
+				}
+				offset += length;
+				m_ValidSize = offset;
+			}
+			return true;
+		}
+
+		void internName(const string& name)
+		{
+			m_Schema.intern(name);
+			m_DefaultIds.push_back(FeatureSchema::getDefault().intern(name));
+		}
+
+		/**
+		* Value of a feature in a profile record of the open file.
+		*/
+		float readValue(const boost::uint8_t* data) const
+		{
+			return m_Version == VERSION_INT_FEATURES ? (float)(boost::int32_t)readUInt32(data) : readFloat(data);
+		}
+
+		/**
+		* Header and records of the open file in the current version, all names first.
+		*/
+		void convert(vector<boost::uint8_t>& records) const
+		{
+			writeUInt32(records, MAGIC);
+			writeUInt16(records, VERSION);
+			writeUInt16(records, 0);
+			for (size_t id = 0; id < m_Schema.size(); id++)
+			{
+				const string& name = m_Schema.getName((FeatureId)id);
+				records.push_back(RECORD_NAME);
+				records.push_back((boost::uint8_t)name.size());
+				records.insert(records.end(), name.begin(), name.end());
+			}
+			for (auto offset = m_Offsets.begin(); offset != m_Offsets.end(); ++offset)
+			{
+				const boost::uint8_t* record = getData() + *offset;
+				size_t count = readUInt16(record + 2);
+				records.insert(records.end(), record, record + 4);
+				const boost::uint8_t* values = record + 4;
+				for (size_t i = 0; i < count; i++, values += 6)
+				{
+					writeUInt16(records, readUInt16(values));
+					writeFloat(records, readValue(values + 2));
+				}
+				records.insert(records.end(), values, values + record[1] * 4);
+			}
+		}
+
+		/**
+		* Appends the records of a profile, and of the names it uses which are new to the file.
+		*/
+		void encode(const PendingProfile& profile, vector<boost::uint8_t>& records)
+		{
+			// Only the features set are stored, under the ids of the file
+			vector<pair<FeatureId, float> > stored;
+			for (auto iter = profile.m_Features.begin(); iter != profile.m_Features.end(); ++iter)
+			{
+				stored.push_back(make_pair(getFileId(iter->first, records), iter->second));
+			}
+
+			records.push_back(RECORD_PROFILE);
+			records.push_back((boost::uint8_t)profile.m_Weights.size());
+			writeUInt16(records, (boost::uint16_t)stored.size());
+			for (auto iter = stored.begin(); iter != stored.end(); ++iter)
+			{
+				writeUInt16(records, iter->first);
+				writeFloat(records, iter->second);
+			}
+			for (auto iter = profile.m_Weights.begin(); iter != profile.m_Weights.end(); ++iter)
+			{
+				writeUInt32(records, (boost::uint32_t)*iter);
+			}
+		}
+
+		/**
+		* Id in the file of a feature of the default schema, its name is appended if it is new to the file.
+		*/
+		FeatureId getFileId(FeatureId id, vector<boost::uint8_t>& records)
+		{
+			const string& name = FeatureSchema::getDefault().getName(id);
+			FeatureId fileId = m_Schema.getId(name);
+			if (fileId == FeatureSchema::NO_FEATURE)
+			{
+				assert(name.size() <= 0xFF);
+				fileId = (FeatureId)m_Schema.size();
+				internName(name);
+				records.push_back(RECORD_NAME);
+				records.push_back((boost::uint8_t)name.size());
+				records.insert(records.end(), name.begin(), name.end());
+			}
+			return fileId;
+		}
+
+		static boost::uint16_t readUInt16(const boost::uint8_t* data)
+		{
+			return (boost::uint16_t)(data[0] | (data[1] << 8));
+		}
+
+		static boost::uint32_t readUInt32(const boost::uint8_t* data)
+		{
+			return (boost::uint32_t)data[0] | ((boost::uint32_t)data[1] << 8) | ((boost::uint32_t)data[2] << 16) | ((boost::uint32_t)data[3] << 24);
+		}
+
+		static float readFloat(const boost::uint8_t* data)
+		{
+			boost::uint32_t bits = readUInt32(data);
+			float value;
+			memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		static void writeUInt16(vector<boost::uint8_t>& buffer, boost::uint16_t value)
+		{
+			buffer.push_back((boost::uint8_t)(value & 0xFF));
+			buffer.push_back((boost::uint8_t)(value >> 8));
+		}
+
+		static void writeUInt32(vector<boost::uint8_t>& buffer, boost::uint32_t value)
+		{
+			writeUInt16(buffer, (boost::uint16_t)(value & 0xFFFF));
+			writeUInt16(buffer, (boost::uint16_t)(value >> 16));
+		}
+
+		static void writeFloat(vector<boost::uint8_t>& buffer, float value)
+		{
+			boost::uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			writeUInt32(buffer, bits);
+		}
+	};
+
+}
+
+#endif // !defined (PROFILE_STORE_H)
@@ -0,0 +1,285 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cassert>
+#include "../../api/GameInfo.h"
+#include "BotRegistry.hpp"
+#include "WorldSnapshot.hpp"
+#include "tools/Random.h"
+
+using namespace std;
+
+/**
+* Spatial index over the level, built once when the match starts.
+* The free cells of the level are listed, so a random free position is drawn in constant time
+* instead of sampling the whole level until a free spot is hit.
+* Bots are kept in buckets of BUCKET_SIZE by BUCKET_SIZE cells and only move between buckets
+* when they cross one, radius and nearest bot queries only visit the buckets around the query.
+*/
+class SpatialGrid
+{
+public:
+	enum
+	{
+		/**
+		* Cells per side of a bot bucket.
+		*/
+		BUCKET_SIZE = 4,
+	};
+
+	enum TeamFilter
+	{
+		ANY_TEAM,
+		OWN_TEAM,
+		ENEMY_TEAM,
+	};
+
+	SpatialGrid() : m_Width(0), m_Height(0), m_BucketColumns(0), m_BucketRows(0) {}
+
+	/**
+	* Lists the free cells of the level and drops all bots.
+	*/
+	void build(const LevelInfo& levelInfo)
+	{
+		m_Width = levelInfo.width;
+		m_Height = levelInfo.height;
+		m_Free.assign(m_Width * m_Height, 0);
+		m_FreeCells.clear();
+		for (int y = 0; y < m_Height; y++)
+		{
+			for (int x = 0; x < m_Width; x++)
+			{
+				if (levelInfo.blockHeights[x][y] == 0.0f)
+				{
+					m_Free[y * m_Width + x] = 1;
+					m_FreeCells.push_back(y * m_Width + x);
+				}
+			}
+		}
+
+		m_BucketColumns = max(1, (m_Width + BUCKET_SIZE - 1) / BUCKET_SIZE);
+		m_BucketRows = max(1, (m_Height + BUCKET_SIZE - 1) / BUCKET_SIZE);
+		m_Buckets.assign(m_BucketColumns * m_BucketRows, vector<BotId>());
+		m_BotBuckets.clear();
+		m_BotPositions.clear();
+		m_OwnTeam.clear();
+	}
+
+	int getWidth() const { return m_Width; }
+	int getHeight() const { return m_Height; }
+	size_t getFreeCellCount() const { return m_FreeCells.size(); }
+
+	bool isFree(int x, int y) const
+	{
+		return x >= 0 && y >= 0 && x < m_Width && y < m_Height && m_Free[y * m_Width + x] != 0;
+	}
+
+	/**
+	* Uniform random position in a free cell of the level, false if all of it is blocked.
+	*/
+	bool findRandomFreePosition(Random& random, Vector2& result) const
+	{
+		if (m_FreeCells.empty())
+		{
+			return false;
+		}
+		unsigned cell = m_FreeCells[random.nextInt((unsigned)m_FreeCells.size())];
+		float x = (float)(cell % m_Width) + random.nextFloat();
+		float y = (float)(cell / m_Width) + random.nextFloat();
+		result = Vector2(x, y);
+		return true;
+	}
+
+	/**
+	* Moves the bots to their positions of the tick, the dead ones and those without position are removed.
+	* Only bots changing bucket touch the buckets.
+	*/
+	void update(const WorldSnapshot& world)
+	{
+		for (BotId id = 0; id < world.getBotCount(); id++)
+		{
+			if (world.hasPosition(id) && world.isAlive(id))
+			{
+				setBot(id, world.getPosition(id), world.isOwnTeam(id));
+			} else
+			{
+				removeBot(id);
+			}
+		}
+	}
+
+	void setBot(BotId id, const Vector2& position, bool ownTeam)
+	{
+		if (id >= m_BotBuckets.size())
+		{
+			m_BotBuckets.resize(id + 1, NO_BUCKET);
+			m_BotPositions.resize(id + 1);
+			m_OwnTeam.resize(id + 1, 0);
+		}
+		unsigned bucket = getBucket(position);
+		if (bucket != m_BotBuckets[id])
+		{
+			removeBot(id);
+			m_Buckets[bucket].push_back(id);
+			m_BotBuckets[id] = bucket;
+		}
+		m_BotPositions[id] = position;
+		m_OwnTeam[id] = ownTeam ? 1 : 0;
+	}
+
+	void removeBot(BotId id)
+	{
+		if (id >= m_BotBuckets.size() || m_BotBuckets[id] == NO_BUCKET)
+		{
+			return;
+		}
+		vector<BotId>& bots = m_Buckets[m_BotBuckets[id]];
+		auto found = find(bots.begin(), bots.end(), id);
+		assert(found != bots.end());
+		*found = bots.back();
+		bots.pop_back();
+		m_BotBuckets[id] = NO_BUCKET;
+	}
+
+	bool contains(BotId id) const { return id < m_BotBuckets.size() && m_BotBuckets[id] != NO_BUCKET; }
+
+	/**
+	* Bots of the given team within the radius of the position, in id order.
+	*/
+	void findInRadius(const Vector2& position, float radius, TeamFilter team, vector<BotId>& result) const
+	{
+		result.clear();
+		if (m_Buckets.empty())
+		{
+			return;
+		}
+		int minColumn = clampColumn(position.x - radius);
+		int maxColumn = clampColumn(position.x + radius);
+		int minRow = clampRow(position.y - radius);
+		int maxRow = clampRow(position.y + radius);
+		float radiusSquared = radius * radius;
+		for (int row = minRow; row <= maxRow; row++)
+		{
+			for (int column = minColumn; column <= maxColumn; column++)
+			{
+				const vector<BotId>& bots = m_Buckets[row * m_BucketColumns + column];
+				for (auto iter = bots.begin(); iter != bots.end(); ++iter)
+				{
+					if (matches(*iter, team) && squaredDistance(position, m_BotPositions[*iter]) <= radiusSquared)
+					{
+						result.push_back(*iter);
+					}
+				}
+			}
+		}
+		sort(result.begin(), result.end());
+	}
+
+	/**
+	* Nearest bot of the given team other than the excluded one, NO_BOT if there is none within the distance.
+	* Buckets are visited in rings around the position until no closer bot can be found.
+	*/
+	BotId findNearest(const Vector2& position, TeamFilter team, BotId exclude = NO_BOT, float maxDistance = numeric_limits<float>::max()) const
+	{
+		BotId nearest = NO_BOT;
+		if (m_Buckets.empty())
+		{
+			return nearest;
+		}
+		float best = maxDistance < numeric_limits<float>::max() ? maxDistance * maxDistance : numeric_limits<float>::max();
+		int column = clampColumn(position.x);
+		int row = clampRow(position.y);
+		int rings = max(m_BucketColumns, m_BucketRows);
+		for (int ring = 0; ring < rings; ring++)
+		{
+			// Buckets of this ring are at least this far from a position inside the center bucket
+			float reach = (float)((ring - 1) * BUCKET_SIZE);
+			if (ring > 1 && reach * reach > best)
+			{
+				break;
+			}
+			for (int y = row - ring; y <= row + ring; y++)
+			{
+				if (y < 0 || y >= m_BucketRows)
+				{
+					continue;
+				}
+				// Inner rows of the ring only have their two outer buckets
+				int step = (y == row - ring || y == row + ring) ? 1 : max(1, 2 * ring);
+				for (int x = column - ring; x <= column + ring; x += step)
+				{
+					if (x < 0 || x >= m_BucketColumns)
+					{
+						continue;
+					}
+					const vector<BotId>& bots = m_Buckets[y * m_BucketColumns + x];
+					for (auto iter = bots.begin(); iter != bots.end(); ++iter)
+					{
+						if (*iter == exclude || !matches(*iter, team))
+						{
+							continue;
+						}
+						float distance = squaredDistance(position, m_BotPositions[*iter]);
+						if (distance < best || (distance == best && *iter < nearest))
+						{
+							best = distance;
+							nearest = *iter;
+						}
+					}
+				}
+			}
+		}
+		return nearest;
+	}
+
+private:
+	enum
+	{
+		NO_BUCKET = ~0u,
+	};
+
+	int m_Width;
+	int m_Height;
+
+	/**
+	* Whether every cell is free, row by row, and the index of every free cell.
+	*/
+	vector<char> m_Free;
+	vector<unsigned> m_FreeCells;
+
+	/**
+	* Bots in every bucket, row by row, and the bucket, position and team of every bot, indexed by id.
+	*/
+	int m_BucketColumns;
+	int m_BucketRows;
+	vector<vector<BotId> > m_Buckets;
+	vector<unsigned> m_BotBuckets;
+	vector<Vector2> m_BotPositions;
+	vector<char> m_OwnTeam;
+
+	int clampColumn(float x) const { return max(0, min(m_BucketColumns - 1, (int)floor(x / BUCKET_SIZE))); }
+	int clampRow(float y) const { return max(0, min(m_BucketRows - 1, (int)floor(y / BUCKET_SIZE))); }
+
+	unsigned getBucket(const Vector2& position) const
+	{
+		return (unsigned)(clampRow(position.y) * m_BucketColumns + clampColumn(position.x));
+	}
+
+	bool matches(BotId id, TeamFilter team) const
+	{
+		return team == ANY_TEAM || (m_OwnTeam[id] != 0) == (team == OWN_TEAM);
+	}
+
+	static float squaredDistance(const Vector2& a, const Vector2& b)
+	{
+		float dx = a.x - b.x;
+		float dy = a.y - b.y;
+		return dx * dx + dy * dy;
+	}
+};
+
+#endif // !defined (SPATIAL_GRID_H)
@@ -1,30 +1,121 @@
+#ifndef STRATEGY_PLANER_H
+#define STRATEGY_PLANER_H
+
+#include <vector>
+#include <memory>
+#include <deque>
+#include <algorithm>
 #include "../../api/GameInfo.h"
 #include "../../api/Commands.h"
 #include "DecisionMaking.h"
 #include "CharacterDecisionMaking.hpp"
+#include "CommandPool.hpp"
+#include "BotRegistry.hpp"
+#include "OpponentFeatures.hpp"
+#include "WorldSnapshot.hpp"
+#include "SpatialGrid.hpp"
+#include "DistanceField.hpp"
+#include "tools/TaskPool.h"
+#include "tools/Instrumentation.h"
 
 using namespace dms;
 
+/**
+* Met once less than half of the bots our team started with are alive.
+*/
 class AliveCondition: public ActivationCondition
 {
 private:
 	int m_AliveOnStart;
-	int m_AliveCurrent;
 
 public:
 	AliveCondition(int botsAlive) 
 	{
-		m_AliveOnStart = m_AliveCurrent = botsAlive;
+		m_AliveOnStart = botsAlive;
+	}
+
+	virtual bool checkCondition(const WorldSnapshot& world)
+	{
+		int alive = 0;
+		for (BotId id = 0; id < world.getBotCount(); id++)
+		{
+			alive += world.isOwnTeam(id) && world.isAlive(id) ? 1 : 0;
+		}
+		return alive < (m_AliveOnStart / 2);
 	}
+};
 
-	virtual bool checkCondition()
+/**
+* Met while the opponent carries our flag.
+*/
+class FlagLostCondition: public ActivationCondition
+{
+public:
+	virtual bool checkCondition(const WorldSnapshot& world)
 	{
-		return m_AliveCurrent < (m_AliveOnStart / 2);
+		return world.getOwnFlagCarrier() != NO_BOT;
 	}
+};
 
-	void setAliveCurrent(int botsAlive)
+/**
+* Met while the opponent leads by at least the given number of points.
+*/
+class ScoreDeficitCondition: public ActivationCondition
+{
+private:
+	int m_Deficit;
+
+public:
+	ScoreDeficitCondition(int deficit = 2) : m_Deficit(deficit) {}
+
+	virtual bool checkCondition(const WorldSnapshot& world)
 	{
-		m_AliveCurrent = botsAlive;
+		return world.getEnemyScore() - world.getScore() >= m_Deficit;
+	}
+};
+
+/**
+* Met once our team went the given number of seconds without progress: no kill, no flag picked up or captured.
+* Only the combat events new in the world are looked at.
+*/
+class ProgressCondition: public ActivationCondition
+{
+private:
+	float m_Limit;
+	float m_LastProgress;
+	float m_LastCheck;
+
+	bool isOwn(const WorldSnapshot& world, const BotInfo* bot) const
+	{
+		BotId id = bot != NULL ? world.getId(*bot) : NO_BOT;
+		return id != NO_BOT && world.isOwnTeam(id);
+	}
+
+public:
+	ProgressCondition(float limit = 60.0f)
+		: m_Limit(limit), m_LastProgress(0.0f), m_LastCheck(0.0f) {}
+
+	virtual bool checkCondition(const WorldSnapshot& world)
+	{
+		if (world.getTimePassed() < m_LastCheck)
+		{
+			// Another match started
+			m_LastProgress = 0.0f;
+		}
+		m_LastCheck = world.getTimePassed();
+
+		const vector<MatchCombatEvent>& events = world.getEvents();
+		for (size_t i = world.getFirstNewEvent(); i < world.getEndEvent(); ++i)
+		{
+			const MatchCombatEvent& event = events[i];
+			if ((event.type == MatchCombatEvent::TYPE_KILLED && isOwn(world, event.killedEventData.instigator))
+				|| (event.type == MatchCombatEvent::TYPE_FLAG_PICKEDUP && isOwn(world, event.flagPickedupEventData.instigator))
+				|| (event.type == MatchCombatEvent::TYPE_FLAG_CAPTURED && isOwn(world, event.flagCapturedEventData.instigator)))
+			{
+				m_LastProgress = event.time;
+			}
+		}
+		return world.getTimePassed() - m_LastProgress > m_Limit;
 	}
 };
 
@@ -39,77 +130,434 @@ public:
 	CommandProfileManager(StrategyPlaner& planer, vector<DecisionMaking*> decisionMakers)
 		: ProfileManager(decisionMakers), m_Planer(&planer) {}
 
-	virtual int performanceUpdate(DecisionMaking& decisionMaker, int currentWeight)
-	{
-		// TODO: change the function
-		return 0;
-	}
+	/**
+	* Only used without a weight update rule, learns from the alert at once with the planer's rule.
+	*/
+	virtual int performanceUpdate(DecisionMaking& decisionMaker, int currentWeight);
+
+	/**
+	* Takes the features the planer extracted for the whole team this tick.
+	*/
+	virtual void updateInternalFeatures();
 };
 
 class StrategyPlaner
 {
 private:
-	AliveCondition* m_CurrentAC;
-
 	// to make it easier to write the code
 	typedef CompositeDecisionMakingSystem CDMS;
-	vector<CDMS*> m_Cdms;
 
+	/**
+	* Decision stack of one bot. It lives for the whole match,
+	* so whatever its profile manager learned survives deaths and respawns.
+	*/
+	struct BotEntry
+	{
+		unique_ptr<AttackerDMS> m_Attacker;
+		unique_ptr<CommandProfileManager> m_Manager;
+		unique_ptr<CDMS> m_Cdms;
+	};
+
+	GameInfo* m_GameInfo;
+	LevelInfo* m_LevelInfo;
+	const BotRegistry* m_Registry;
+	boost::uint64_t m_MatchSeed;
+
+	/**
+	* Watches the whole team once per tick and alerts the profile managers of all bots.
+	*/
+	TeamMonitor m_Monitor;
+	unique_ptr<AliveCondition> m_CurrentAC;
+	FlagLostCondition m_FlagLost;
+	ScoreDeficitCondition m_ScoreDeficit;
+	ProgressCondition m_Progress;
+
+	/**
+	* Features of the opponent, updated once per tick and shared by the profile managers of all bots.
+	*/
+	OpponentFeatureExtractor m_Opponent;
+
+	/**
+	* Free cells of the level and the bots around every place, updated once per tick before the bots decide.
+	*/
+	SpatialGrid m_Grid;
+
+	/**
+	* Walking distances to the flags and score locations, searched when read after their target moved.
+	*/
+	DistanceFieldCache m_DistanceFields;
+
+	/**
+	* Entry of every bot, indexed by bot id. Enemy bots have no entry.
+	*/
+	vector<unique_ptr<BotEntry> > m_Bots;
+
+	/**
+	* Bots ticked this tick, alive and done with their last command.
+	*/
+	vector<BotId> m_Active;
+
+	/**
+	* Owns the commands of all bots, one slot per bot.
+	*/
+	CommandPool m_CommandPool;
+
+	/**
+	* Ticks the CDMS of every bot concurrently, NULL when ticking serially.
+	*/
+	unique_ptr<TaskPool> m_Pool;
+
+	/**
+	* Command of every active bot, indexed like m_Active.
+	*/
+	vector<const Command*> m_Results;
+
+	/**
+	* Bot of every command of the last tick, indexed like the commands.
+	*/
+	vector<BotId> m_CommandBots;
+
+	/**
+	* Receives the planer and per-bot latencies, may be NULL.
+	*/
+	Instrumentation* m_Instrumentation;
+
+	/**
+	* Profiles of earlier sessions every bot starts from, may be NULL.
+	*/
+	ProfileLibrary* m_Library;
+
+	/**
+	* Profiles the bots search on an alert, indexed once for all of them.
+	*/
+	LibraryIndex m_LibraryIndex;
+
+	/**
+	* How the weights of every bot learn from the rewards of alerts and of the match.
+	*/
+	BanditUpdateRule m_UpdateRule;
+
+	/**
+	* World of the current tick, and the one built by the planer when none was given.
+	*/
+	const WorldSnapshot* m_World;
+	WorldSnapshot m_OwnWorld;
+
+	void tickCdms(size_t index)
+	{
+		BotId id = m_Active[index];
+		ScopedTimer timer(m_Instrumentation != NULL ? m_Instrumentation->botTimer(id) : NULL);
+		m_Results[index] = m_Bots[id]->m_Cdms->tick(*m_World);
+	}
+
+	/**
+	* Builds the decision stack of one of our bots.
+	*/
+	void addBot(BotId id)
+	{
+		if (m_Bots[id] || !m_Registry->isOwnTeam(id))
+		{
+			return;
+		}
+
+		const BotInfo& bot = m_Registry->getBot(id);
+		unique_ptr<BotEntry> entry(new BotEntry());
+		entry->m_Attacker.reset(new AttackerDMS(id, Random(m_MatchSeed, Random::hash(bot.name)), m_Grid, m_CommandPool, id));
+
+		vector<DecisionMaking*> decisionMakers;
+		decisionMakers.push_back(entry->m_Attacker.get());
+
+		entry->m_Manager.reset(new CommandProfileManager(*this, decisionMakers));
+		entry->m_Manager->setProfileLibrary(m_Library);
+		entry->m_Manager->setLibraryIndex(&m_LibraryIndex);
+		entry->m_Manager->setWeightUpdateRule(&m_UpdateRule);
+		entry->m_Manager->setSimilarityThreshold(OpponentFeatureExtractor::getSimilarityThreshold());
+		entry->m_Cdms.reset(new CDMS(*entry->m_Manager));
+		m_Monitor.addProfileManager(*entry->m_Manager);
+		entry->m_Cdms->init();
+
+		m_Bots[id] = move(entry);
+	}
 
 public:
-	StrategyPlaner(GameInfo& gameInfo, LevelInfo& levelInfo)
+	/**
+	* Every bot draws from its own random stream derived from the match seed,
+	* so a match replays identically for the same seed.
+	*/
+	StrategyPlaner(GameInfo& gameInfo, LevelInfo& levelInfo, const BotRegistry& registry, boost::uint64_t matchSeed = 0)
+		: m_GameInfo(&gameInfo), m_LevelInfo(&levelInfo), m_Registry(&registry), m_MatchSeed(matchSeed),
+		  m_Instrumentation(NULL), m_Library(NULL), m_World(NULL)
+	{
+		m_CurrentAC.reset(new AliveCondition(gameInfo.team->members.size()));
+		m_Monitor.addCondition(*m_CurrentAC);
+		m_Monitor.addCondition(m_FlagLost);
+		m_Monitor.addCondition(m_ScoreDeficit);
+		m_Monitor.addCondition(m_Progress);
+		m_Grid.build(levelInfo);
+		m_DistanceFields.init(m_Grid);
+	}
+
+	void init() 
+	{
+		m_Bots.resize(m_Registry->size());
+		m_CommandPool.reserve(m_Registry->size());
+
+		for (BotId id = 0; id < m_Registry->size(); id++)
+		{
+			addBot(id);
+		}
+	}
+
+	/**
+	* Brings the opponent features, the monitor and the bots to tick up to date with the world of this tick,
+	* which must be set first. Entries are never rebuilt, only bots alive and available are ticked.
+	*/
+	void update()
+	{
+		const WorldSnapshot& world = *m_World;
+		m_Opponent.update(world);
+		m_Monitor.update(world);
+
+		m_Active.clear();
+		for (BotId id = 0; id < m_Bots.size(); id++)
+		{
+			if (m_Bots[id] && world.isAlive(id) && world.isAvailable(id))
+			{
+				m_Active.push_back(id);
+			}
+		}
+	}
+
+	const OpponentFeatureExtractor& getOpponent() const { return m_Opponent; }
+	const TeamMonitor& getMonitor() const { return m_Monitor; }
+	const SpatialGrid& getGrid() const { return m_Grid; }
+	const DistanceFieldCache& getDistanceFields() const { return m_DistanceFields; }
+
+	/**
+	* Library the profile managers of all bots load from and save to, must be set before init().
+	*/
+	void setProfileLibrary(ProfileLibrary* library) { m_Library = library; }
+
+	const WeightUpdateRule& getUpdateRule() const { return m_UpdateRule; }
+
+	/**
+	* Rewards the current DMS of every bot, e.g. with the outcome of the match.
+	*/
+	void reward(float reward)
 	{
-		int botsAlive = gameInfo.bots_alive.size();
-		if (m_CurrentAC == NULL)
+		for (auto i = m_Bots.begin(); i != m_Bots.end(); i++)
 		{
-			AliveCondition ac(botsAlive);
-			m_CurrentAC = &ac;
-		} else 
+			if (*i)
+			{
+				(*i)->m_Manager->reward(reward);
+			}
+		}
+	}
+
+	/**
+	* Updates the weights of every bot with the rewards collected since the last call.
+	* The rewards of alerts are only collected while ticking, so the tick stays as fast while learning.
+	*/
+	void applyRewards()
+	{
+		for (auto i = m_Bots.begin(); i != m_Bots.end(); i++)
 		{
-			m_CurrentAC->setAliveCurrent(botsAlive);
+			if (*i)
+			{
+				(*i)->m_Manager->applyRewards();
+			}
 		}
+	}
 
-		// The 'bots_available' list is a dynamically calculated list of bots that are done with their commands.
-		for (auto i = gameInfo.bots_available.begin(), end = gameInfo.bots_available.end(); i!=end; ++i)
+	/**
+	* Adds the changed profiles of all bots to the library, once the session ends.
+	* Bots which faced the same style have profiles of the same features, e.g. the default one,
+	* each of those is added once with the mean weights of its bots.
+	*/
+	void saveProfiles()
+	{
+		if (m_Library == NULL)
 		{
-			vector<DecisionMaking*> decisionMakers;
+			return;
+		}
+
+		deque<Profile> profiles;
+		vector<int> counts;
+		for (auto i = m_Bots.begin(); i != m_Bots.end(); i++)
+		{
+			Profile* changed = *i ? (*i)->m_Manager->takeChangedProfile() : NULL;
+			if (changed == NULL)
+			{
+				continue;
+			}
+
+			size_t index = 0;
+			while (index < profiles.size() && !(profiles[index].getFeatures() == changed->getFeatures()))
+			{
+				index++;
+			}
+			if (index == profiles.size())
+			{
+				profiles.push_back(Profile());
+				profiles.back().init((*i)->m_Manager->getDecisionMakers());
+				profiles.back().getFeatures() = changed->getFeatures();
+				for (size_t dms = 0; dms < changed->getDecisionMakerCount(); dms++)
+				{
+					profiles.back().setWeight(dms, 0);
+				}
+				counts.push_back(0);
+			}
+
+			Profile& profile = profiles[index];
+			for (size_t dms = 0; dms < changed->getDecisionMakerCount(); dms++)
+			{
+				profile.setWeight(dms, profile.getWeight(dms) + changed->getWeight(dms));
+			}
+			counts[index]++;
+		}
+
+		for (size_t index = 0; index < profiles.size(); index++)
+		{
+			Profile& profile = profiles[index];
+			for (size_t dms = 0; dms < profile.getDecisionMakerCount(); dms++)
+			{
+				profile.setWeight(dms, profile.getWeight(dms) / counts[index]);
+			}
+			m_Library->add(profile);
+		}
+	}
 
-			const BotInfo& bot = **i;
-			AttackerDMS attacker(bot, gameInfo, levelInfo);
-			decisionMakers.push_back(&attacker);
+	/**
+	* Times the planer and every bot with the given instrumentation.
+	*/
+	void setInstrumentation(Instrumentation* instrumentation)
+	{
+		m_Instrumentation = instrumentation;
+		if (m_Instrumentation != NULL)
+		{
+			for (BotId id = 0; id < m_Registry->size(); id++)
+			{
+				m_Instrumentation->setBotName(id, m_Registry->getBot(id).name);
+			}
+		}
+	}
 
-			CommandProfileManager manager(*this, decisionMakers);
-			Monitor monitor(*m_CurrentAC, manager);
-			CDMS cdms(manager, monitor);
-			m_Cdms.push_back(&cdms);
+	/**
+	* Weight of the connection the bot currently decides with, 0 for bots without entry.
+	*/
+	int getCurrentWeight(BotId id) const
+	{
+		if (id >= m_Bots.size() || !m_Bots[id])
+		{
+			return 0;
 		}
+		const Profile* profile = m_Bots[id]->m_Manager->getCurrentProfile();
+		return profile->getDecisionMakerCount() > 0 ? profile->getCurrentWeight() : 0;
 	}
-	~StrategyPlaner()
+
+	size_t getBotCount() const
 	{
-		m_CurrentAC = NULL;
+		size_t count = 0;
+		for (auto i = m_Bots.begin(); i != m_Bots.end(); i++)
+		{
+			count += *i ? 1 : 0;
+		}
+		return count;
 	}
 
-	void init() 
+	/**
+	* Sets the number of threads used to tick the bots.
+	* One thread (the default) ticks them serially on the calling thread.
+	*/
+	void setThreadCount(unsigned threads)
 	{
-		for (auto i = m_Cdms.begin(); i != m_Cdms.end(); i++)
+		if (threads > 1)
 		{
-			(*i)->init();
+			m_Pool.reset(new TaskPool(threads));
+		} else
+		{
+			m_Pool.reset();
 		}
 	}
 
-	vector<const Command*> tick()
+	/**
+	* Ticks every available bot and writes their commands in bot order into the given buffer.
+	* The buffer is cleared first, reusing it across ticks avoids allocations.
+	* The commands are owned by the planer and stay valid until the next tick.
+	* All bots decide on the given world, built for this tick.
+	*/
+	void tick(const WorldSnapshot& world, vector<const Command*>& commands)
 	{
-		vector<const Command*> commands;
-		for (auto i = m_Cdms.begin(); i != m_Cdms.end(); i++)
+		ScopedTimer timer(m_Instrumentation != NULL ? m_Instrumentation->timer(Instrumentation::STAGE_PLANER) : NULL);
+		m_World = &world;
+		update();
+		m_Grid.update(world);
+		m_DistanceFields.update(world);
+
+		m_Results.assign(m_Active.size(), NULL);
+		if (m_Pool)
+		{
+			m_Pool->run(m_Active.size(), TaskPool::Task(this, &StrategyPlaner::tickCdms));
+		} else
 		{
-			const Command *command = (*i)->tick();
-			if (NULL != command) 
+			for (size_t i = 0; i < m_Active.size(); i++)
 			{
-				commands.push_back(command);
+				tickCdms(i);
 			}
 		}
 
+		commands.clear();
+		m_CommandBots.clear();
+		for (size_t i = 0; i < m_Results.size(); i++)
+		{
+			if (NULL != m_Results[i]) 
+			{
+				commands.push_back(m_Results[i]);
+				m_CommandBots.push_back(m_Active[i]);
+			}
+		}
+	}
+
+	/**
+	* Ids of the bots the commands of the last tick are for, in the same order.
+	*/
+	const vector<BotId>& getCommandBots() const { return m_CommandBots; }
+
+	/**
+	* Hands a command of the last tick over to the caller, see CommandPool::release().
+	*/
+	Command* releaseCommand(BotId id, const Command& command)
+	{
+		// Every bot emits into the slot of its id
+		return m_CommandPool.release(id, command);
+	}
+
+	/**
+	* Same as above on a world the planer builds from the game.
+	*/
+	void tick(vector<const Command*>& commands)
+	{
+		m_OwnWorld.build(*m_GameInfo, *m_LevelInfo, *m_Registry);
+		tick(m_OwnWorld, commands);
+	}
+
+	vector<const Command*> tick()
+	{
+		vector<const Command*> commands;
+		tick(commands);
 		return commands;
 	}
 
 };
+
+inline int CommandProfileManager::performanceUpdate(DecisionMaking& decisionMaker, int currentWeight)
+{
+	return m_Planer->getUpdateRule().update(currentWeight, getAlertReward());
+}
+
+inline void CommandProfileManager::updateInternalFeatures()
+{
+	m_InternalFeatures = m_Planer->getOpponent().getFeatures();
+}
+
+#endif // !defined (STRATEGY_PLANER_H)
\ No newline at end of file
@@ -0,0 +1,183 @@
+#ifndef WORLD_SNAPSHOT_H
+#define WORLD_SNAPSHOT_H
+
+#include <vector>
+#include <string>
+#include <map>
+#include "../../api/GameInfo.h"
+#include "BotRegistry.hpp"
+
+using namespace std;
+
+/**
+* Read-only copy of the world for one tick, built once and handed to every decision maker.
+* Per-bot state is kept in flat arrays indexed by bot id, so decisions read it sequentially
+* instead of chasing pointers through GameInfo, and bots can decide concurrently while nothing changes it.
+* The arrays are reused, building a snapshot every tick does not allocate once the bots are known.
+*/
+class WorldSnapshot
+{
+public:
+	WorldSnapshot()
+		: m_Registry(NULL), m_Level(NULL), m_Events(NULL), m_FirstNewEvent(0), m_EndEvent(0), m_TimePassed(0.0f), m_Score(0), m_EnemyScore(0),
+		  m_OwnFlagCarrier(NO_BOT), m_EnemyFlagCarrier(NO_BOT), m_OwnFlagInfo(NULL) {}
+
+	/**
+	* Copies the state of the current tick. The combat events added since the last build are the new ones.
+	*/
+	void build(const GameInfo& gameInfo, const LevelInfo& levelInfo, const BotRegistry& registry)
+	{
+		size_t count = registry.size();
+		m_Registry = &registry;
+		m_Level = &levelInfo;
+		m_Positions.resize(count);
+		m_HasPosition.resize(count);
+		m_Health.resize(count);
+		m_States.resize(count);
+		m_Alive.resize(count);
+		m_Seen.resize(count);
+		m_Available.assign(count, 0);
+
+		for (BotId id = 0; id < count; id++)
+		{
+			const BotInfo& bot = registry.getBot(id);
+			m_HasPosition[id] = bot.position ? 1 : 0;
+			m_Positions[id] = bot.position ? *bot.position : Vector2(0.0f, 0.0f);
+			m_Health[id] = bot.health ? *bot.health : 0.0f;
+			m_States[id] = bot.state ? *bot.state : BotInfo::STATE_UNKNOWN;
+			// Our bots are alive while listed as such, of the enemies only their health is known
+			m_Alive[id] = !registry.isOwnTeam(id) && m_Health[id] > 0.0f ? 1 : 0;
+			m_Seen[id] = bot.seenBy.empty() ? 0 : 1;
+		}
+		mark(gameInfo.bots_alive, m_Alive);
+		// The 'bots_available' list is a dynamically calculated list of bots that are done with their commands.
+		mark(gameInfo.bots_available, m_Available);
+
+		const TeamInfo& team = *gameInfo.team;
+		const TeamInfo& enemyTeam = *gameInfo.enemyTeam;
+		m_OwnFlag = team.flag->position;
+		m_EnemyFlag = enemyTeam.flag->position;
+		m_OwnFlagCarrier = team.flag->carrier != NULL ? registry.getId(*team.flag->carrier) : NO_BOT;
+		m_EnemyFlagCarrier = enemyTeam.flag->carrier != NULL ? registry.getId(*enemyTeam.flag->carrier) : NO_BOT;
+		m_OwnScoreLocation = team.flagScoreLocation;
+		m_EnemyScoreLocation = enemyTeam.flagScoreLocation;
+		m_OwnFlagInfo = team.flag;
+		m_OwnFlagSpawnLocation = team.flagSpawnLocation;
+		m_EnemySpawnArea = enemyTeam.botSpawnArea;
+
+		const MatchInfo& match = *gameInfo.match;
+		m_TimePassed = match.timePassed;
+		m_Score = getScore(match, team.name);
+		m_EnemyScore = getScore(match, enemyTeam.name);
+
+		m_Events = &match.combatEvents;
+		m_FirstNewEvent = m_EndEvent <= m_Events->size() ? m_EndEvent : 0;
+		m_EndEvent = m_Events->size();
+	}
+
+	size_t getBotCount() const { return m_Positions.size(); }
+
+	const string& getName(BotId id) const { return m_Registry->getBot(id).name; }
+
+	/**
+	* Id of a bot the events refer to, NO_BOT if it is not known.
+	*/
+	BotId getId(const BotInfo& bot) const { return m_Registry->getId(bot); }
+	bool isOwnTeam(BotId id) const { return m_Registry->isOwnTeam(id); }
+	bool hasPosition(BotId id) const { return m_HasPosition[id] != 0; }
+	const Vector2& getPosition(BotId id) const { return m_Positions[id]; }
+	float getHealth(BotId id) const { return m_Health[id]; }
+	int getState(BotId id) const { return m_States[id]; }
+
+	/**
+	* Whether the bot is alive, see GameInfo::bots_alive for our bots and the health for the enemies.
+	*/
+	bool isAlive(BotId id) const { return m_Alive[id] != 0; }
+
+	/**
+	* Whether any bot of the other team sees the bot.
+	*/
+	bool isSeen(BotId id) const { return m_Seen[id] != 0; }
+
+	/**
+	* Whether the bot is done with its orders, see GameInfo::bots_available.
+	*/
+	bool isAvailable(BotId id) const { return m_Available[id] != 0; }
+
+	const Vector2& getOwnFlag() const { return m_OwnFlag; }
+	const Vector2& getEnemyFlag() const { return m_EnemyFlag; }
+	BotId getOwnFlagCarrier() const { return m_OwnFlagCarrier; }
+	BotId getEnemyFlagCarrier() const { return m_EnemyFlagCarrier; }
+	const Vector2& getOwnScoreLocation() const { return m_OwnScoreLocation; }
+	const Vector2& getEnemyScoreLocation() const { return m_EnemyScoreLocation; }
+	const Vector2& getOwnFlagSpawnLocation() const { return m_OwnFlagSpawnLocation; }
+	const pair<Vector2, Vector2>& getEnemySpawnArea() const { return m_EnemySpawnArea; }
+
+	/**
+	* Whether the flag the events refer to is ours.
+	*/
+	bool isOwnFlag(const FlagInfo* flag) const { return flag != NULL && flag == m_OwnFlagInfo; }
+
+	float getTimePassed() const { return m_TimePassed; }
+	int getScore() const { return m_Score; }
+	int getEnemyScore() const { return m_EnemyScore; }
+
+	/**
+	* Combat events added since the last tick, in [getFirstNewEvent(), getEndEvent()) of getEvents().
+	*/
+	const vector<MatchCombatEvent>& getEvents() const { return *m_Events; }
+	size_t getFirstNewEvent() const { return m_FirstNewEvent; }
+	size_t getEndEvent() const { return m_EndEvent; }
+
+	const LevelInfo& getLevel() const { return *m_Level; }
+
+private:
+	const BotRegistry* m_Registry;
+	const LevelInfo* m_Level;
+
+	vector<Vector2> m_Positions;
+	vector<char> m_HasPosition;
+	vector<float> m_Health;
+	vector<int> m_States;
+	vector<char> m_Alive;
+	vector<char> m_Seen;
+	vector<char> m_Available;
+
+	const vector<MatchCombatEvent>* m_Events;
+	size_t m_FirstNewEvent;
+	size_t m_EndEvent;
+
+	float m_TimePassed;
+	int m_Score;
+	int m_EnemyScore;
+
+	Vector2 m_OwnFlag;
+	Vector2 m_EnemyFlag;
+	BotId m_OwnFlagCarrier;
+	BotId m_EnemyFlagCarrier;
+	Vector2 m_OwnScoreLocation;
+	Vector2 m_EnemyScoreLocation;
+	const FlagInfo* m_OwnFlagInfo;
+	Vector2 m_OwnFlagSpawnLocation;
+	pair<Vector2, Vector2> m_EnemySpawnArea;
+
+	void mark(const vector<BotInfo*>& bots, vector<char>& flags) const
+	{
+		for (auto iter = bots.begin(); iter != bots.end(); ++iter)
+		{
+			BotId id = m_Registry->getId(**iter);
+			if (id != NO_BOT)
+			{
+				flags[id] = 1;
+			}
+		}
+	}
+
+	static int getScore(const MatchInfo& match, const string& team)
+	{
+		auto found = match.scores.find(team);
+		return found != match.scores.end() ? found->second : 0;
+	}
+};
+
+#endif // !defined (WORLD_SNAPSHOT_H)
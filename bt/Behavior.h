@@ -5,17 +5,18 @@
 #endif // _MSC_VER > 1000
 
 #include <vector>
-#include <deque>
+#include <cassert>
 #include <iostream>
-#include <FastDelegate.h>
 //#include "../tools/asserts.h"
+#include "../tools/RingBuffer.h"
+#include "../tools/Delegate.h"
+#include "../tools/Instrumentation.h"
 
 using namespace std;
-using namespace fastdelegate;
 
 namespace bt
 {
-	typedef FastDelegate<void ()> BehaviorObserver;
+	typedef Delegate<void ()> BehaviorObserver;
 
 	enum Status {
 		/**
@@ -40,6 +41,31 @@ namespace bt
 		BH_SUSPENDED,
 	};
 
+	/**
+	* Kind of a node inside a compiled behavior tree.
+	*/
+	enum NodeType {
+		/**
+		* Action or condition, ticked through its behavior.
+		*/
+		NODE_LEAF,
+		/**
+		* Runs its children in order until one of them fails.
+		*/
+		NODE_SEQUENCE,
+		/**
+		* Runs its children in order until one of them does not fail.
+		*/
+		NODE_SELECTOR,
+	};
+
+	/**
+	* Index used by nodes that are not part of a compiled tree.
+	*/
+	const unsigned BH_NO_NODE = ~0u;
+
+	class Composite;
+
 	/******************************************************************************/
 
 	/*
@@ -50,6 +76,8 @@ namespace bt
 	public:
 		Behavior() {
 			m_eStatus = BH_INVALID;
+			m_NodeIndex = BH_NO_NODE;
+			m_pParent = NULL;
 		}
 
 		/**
@@ -95,14 +123,94 @@ namespace bt
 		*/
 		virtual void onTerminate(Status)	{}
 
+		/**
+		* Kind of node this behavior compiles to.
+		*/
+		virtual NodeType getType() const	{ return NODE_LEAF; }
+
 		Status m_eStatus;
 		BehaviorObserver m_Observer;
+
+		/**
+		* Composite that gets notified once this behavior has finished.
+		*/
+		Composite* m_pParent;
+
+		/**
+		* Position of this behavior in the node array of a compiled tree.
+		*/
+		unsigned m_NodeIndex;
+	};
+
+	/**
+	* Node of a compiled behavior tree.
+	* The children of a node are stored next to each other, so its child range is
+	* [m_FirstChild, m_FirstChild + m_ChildCount).
+	*/
+	struct FlatNode
+	{
+		Behavior* m_pBehavior;
+		NodeType m_eType;
+		Status m_eStatus;
+		unsigned m_Parent;
+		unsigned m_FirstChild;
+		unsigned m_ChildCount;
+		/**
+		* Offset of the active child inside the child range.
+		*/
+		unsigned m_Current;
 	};
 
 	/* Controls the main execution of the behavior tree */
 	class BehaviorTree
 	{
 	public :
+		BehaviorTree()
+			: m_ActiveLeaf(BH_NO_NODE), m_Pending(0), m_pTickTimer(NULL) {}
+
+		/**
+		* Records the latency of every tick() into the given histogram, NULL to stop.
+		*/
+		void setTickTimer(LatencyHistogram* histogram)
+		{
+			m_pTickTimer = histogram;
+		}
+
+		/**
+		* Makes room for the given number of active behaviors,
+		* so that ticking a tree of that size never allocates.
+		*/
+		void reserve(size_t behaviors)
+		{
+			m_Behaviors.reserve(behaviors);
+		}
+
+		/**
+		* Compiles the tree under the given root into one contiguous node array and activates it,
+		* replacing the tree compiled before. Composites of a compiled tree are driven by the tree itself
+		* and the status of every node is kept in the array; its one active leaf is ticked after the
+		* queued behaviors, without ever entering the queue. A behavior may appear only once in a compiled tree.
+		* 
+		* @param root
+		*            - root of the tree
+		* @param observer
+		*            - notified once the root has finished
+		*/
+		void compile(Behavior& root, BehaviorObserver* observer = NULL);
+
+		const vector<FlatNode>& getNodes() const { return m_Nodes; }
+
+		/**
+		* Runs the compiled tree again from its root, dropping the leaf that is still active if any.
+		*/
+		void restart()
+		{
+			if (!m_Nodes.empty())
+			{
+				startNode(0);
+			}
+		}
+
 		/**
 		* Insert active behavior.
 		* 
@@ -115,7 +223,22 @@ namespace bt
 			{
 				bh.m_Observer = *observer;
 			}
-			m_Behaviors.push_front(&bh);
+			schedule(bh);
+		}
+
+		/**
+		* Insert active child behavior.
+		* The parent is notified directly once the child has finished.
+		* 
+		* @param bh
+		*            - active behavior
+		* @param parent
+		*            - composite that owns the behavior
+		*/
+		void insert(Behavior& bh, Composite& parent)
+		{
+			bh.m_pParent = &parent;
+			schedule(bh);
 		}
 
 		/*void insert(Behavior& bh) 
@@ -129,7 +252,11 @@ namespace bt
 			//ASSERT(result != BH_RUNNING);
 			bh.m_eStatus = result;
 
-			if (!bh.m_Observer.empty())
+			if (bh.m_pParent != NULL)
+			{
+				notifyParent(bh);
+			}
+			else if (!bh.m_Observer.empty())
 			{
 				//cout << "Notifying observer of behavior: " << &bh << endl;
 				bh.m_Observer();
@@ -143,13 +270,16 @@ namespace bt
 		*/
 		void tick() 
 		{
-			// Insert an end-of-update marker into the list of tasks.
-			m_Behaviors.push_back(NULL);
+			ScopedTimer timer(m_pTickTimer);
+
+			// Everything queued so far belongs to this update.
+			m_Pending = m_Behaviors.size();
 
 			while (step()) 
 			{
 				continue;
 			}
+			tickNodes();
 		}
 
 		/**
@@ -159,15 +289,16 @@ namespace bt
 		*/
 		bool step() 
 		{
-			// Get the first element of the deque and remove it.
-			Behavior* current = m_Behaviors.front();
-			m_Behaviors.pop_front();
-
-			// If this is the end-of-update marker, stop processing.
-			if (current == NULL) {
+			// If every task of this update was processed, stop processing.
+			if (m_Pending == 0) {
 				return false;
 			}
 
+			// Get the first element of the queue and remove it.
+			Behavior* current = m_Behaviors.front();
+			m_Behaviors.pop_front();
+			--m_Pending;
+
 			// Perform the update on this individual task.
 			if (current->m_eStatus != BH_SUSPENDED)
 			{
@@ -179,8 +310,21 @@ namespace bt
 			}
 
 
+			// Children of a composite notify their parent once they are finished.
+			if (current->m_pParent != NULL)
+			{
+				if (current->m_eStatus == BH_SUCCESS || current->m_eStatus == BH_FAILURE)
+				{
+					notifyParent(*current);
+				}
+				// Suspended composites are woken up by their children.
+				else if (current->m_eStatus == BH_RUNNING || current->getType() == NODE_LEAF)
+				{
+					m_Behaviors.push_back(current);
+				}
+			}
 			// Process the observer if the task is terminated.
-			if (current->m_eStatus != BH_RUNNING && (current->m_Observer != NULL))
+			else if (current->m_eStatus != BH_RUNNING && !current->m_Observer.empty())
 			{
 				// Call the observer to notify the parent
 				//cout << "Notifying observer of behavior: " << current << endl;
@@ -195,7 +339,51 @@ namespace bt
 		}
 
 	protected:
-		deque<Behavior*> m_Behaviors;
+		RingBuffer<Behavior*> m_Behaviors;
+		vector<FlatNode> m_Nodes;
+
+		/**
+		* Leaf of the compiled tree to tick next, BH_NO_NODE once the tree has finished.
+		* Sequences and selectors run one child at a time, so there is never more than one.
+		*/
+		unsigned m_ActiveLeaf;
+
+		/**
+		* Number of queued tasks that still belong to the current update.
+		* Tasks pushed back for the next update are not counted.
+		*/
+		size_t m_Pending;
+
+		LatencyHistogram* m_pTickTimer;
+
+		/**
+		* Queues a behavior to run within the current update.
+		*/
+		void schedule(Behavior& bh)
+		{
+			m_Behaviors.push_front(&bh);
+			++m_Pending;
+		}
+
+		void appendNode(Behavior& bh, unsigned parent);
+
+		/**
+		* Activates a node of the compiled tree.
+		* Composites descend to their first child, so only leaves are ever active.
+		*/
+		void startNode(unsigned index);
+
+		/**
+		* Ticks the active leaf of the compiled tree, and the leaves its result activates, until one keeps running.
+		*/
+		void tickNodes();
+
+		/**
+		* Propagates the result of a finished node up through its parents.
+		*/
+		void completeNode(unsigned index, Status status);
+
+		void notifyParent(Behavior& bh);
 	};
 
 	/******************************************************************************/
@@ -209,9 +397,18 @@ namespace bt
 		void add(Behavior* bh) { 
 			m_Children.push_back(bh); 
 		};
-	protected:
+
 		typedef vector<Behavior*> Behaviors;
+		const Behaviors& getChildren() const { return m_Children; }
+	protected:
 		Behaviors m_Children;
+
+		friend class BehaviorTree;
+
+		/**
+		* Called by the tree once the current child has finished.
+		*/
+		virtual void onChildComplete() = 0;
 	};
 
 	class Sequence : public Composite
@@ -222,15 +419,15 @@ namespace bt
 			m_pBehaviorTree = &bt;
 		}
 
+		virtual NodeType getType() const { return NODE_SEQUENCE; }
+
 	protected:
 		BehaviorTree* m_pBehaviorTree;
 
 		virtual void onInitialize()
 		{
 			m_Current = m_Children.begin();
-			BehaviorObserver observer;
-			observer.bind(this, &Sequence::onChildComplete);
-			m_pBehaviorTree->insert(**m_Current, &observer);
+			m_pBehaviorTree->insert(**m_Current, *this);
 		}
 
 		virtual void onChildComplete() 
@@ -250,9 +447,7 @@ namespace bt
 			}
 			else
 			{
-				BehaviorObserver observer;
-				observer.bind(this, &Sequence::onChildComplete);
-				m_pBehaviorTree->insert((**m_Current), &observer);
+				m_pBehaviorTree->insert(**m_Current, *this);
 			}
 
 		}
@@ -292,15 +487,15 @@ namespace bt
 		{
 			m_pBehaviorTree = &bt;
 		}
+
+		virtual NodeType getType() const { return NODE_SELECTOR; }
 	protected:
 		BehaviorTree* m_pBehaviorTree;
 
 		virtual void onInitialize()
 		{
 			m_Current = m_Children.begin();
-			BehaviorObserver observer;
-			observer.bind(this, &Selector::onChildComplete);
-			m_pBehaviorTree->insert((**m_Current), &observer);
+			m_pBehaviorTree->insert(**m_Current, *this);
 		}
 		
 		virtual void onChildComplete() 
@@ -320,9 +515,7 @@ namespace bt
 			}
 			else
 			{
-				BehaviorObserver observer;
-				observer.bind(this, &Selector::onChildComplete);
-				m_pBehaviorTree->insert((**m_Current), &observer);
+				m_pBehaviorTree->insert(**m_Current, *this);
 			}
 
 		}
@@ -356,5 +549,142 @@ namespace bt
 	};
 
 	/******************************************************************************/
+
+	inline void BehaviorTree::notifyParent(Behavior& bh)
+	{
+		bh.m_pParent->onChildComplete();
+	}
+
+	inline void BehaviorTree::compile(Behavior& root, BehaviorObserver* observer)
+	{
+		// The behaviors of the previous tree may be used on their own again
+		for (auto iter = m_Nodes.begin(); iter != m_Nodes.end(); ++iter)
+		{
+			iter->m_pBehavior->m_NodeIndex = BH_NO_NODE;
+		}
+		m_Nodes.clear();
+		m_ActiveLeaf = BH_NO_NODE;
+		appendNode(root, BH_NO_NODE);
+
+		// Breadth-first, so the children of every node end up next to each other.
+		for (unsigned i = 0; i < m_Nodes.size(); ++i)
+		{
+			if (m_Nodes[i].m_eType == NODE_LEAF)
+			{
+				continue;
+			}
+
+			const Composite::Behaviors& children = static_cast<Composite*>(m_Nodes[i].m_pBehavior)->getChildren();
+			m_Nodes[i].m_FirstChild = m_Nodes.size();
+			m_Nodes[i].m_ChildCount = children.size();
+			for (auto iter = children.begin(); iter != children.end(); ++iter)
+			{
+				appendNode(**iter, i);
+			}
+		}
+
+		if (observer != NULL)
+		{
+			root.m_Observer = *observer;
+		}
+		startNode(0);
+	}
+
+	inline void BehaviorTree::appendNode(Behavior& bh, unsigned parent)
+	{
+		FlatNode node;
+		node.m_pBehavior = &bh;
+		node.m_eType = bh.getType();
+		node.m_eStatus = BH_INVALID;
+		node.m_Parent = parent;
+		node.m_FirstChild = 0;
+		node.m_ChildCount = 0;
+		node.m_Current = 0;
+
+		assert(bh.m_NodeIndex == BH_NO_NODE);
+		bh.m_NodeIndex = m_Nodes.size();
+		// Composites of a compiled tree are never told about their children
+		bh.m_pParent = NULL;
+		m_Nodes.push_back(node);
+	}
+
+	inline void BehaviorTree::startNode(unsigned index)
+	{
+		while (m_Nodes[index].m_eType != NODE_LEAF)
+		{
+			FlatNode& node = m_Nodes[index];
+			node.m_eStatus = BH_RUNNING;
+			node.m_Current = 0;
+			if (node.m_ChildCount == 0)
+			{
+				// An empty sequence succeeds, an empty selector fails.
+				completeNode(index, node.m_eType == NODE_SEQUENCE ? BH_SUCCESS : BH_FAILURE);
+				return;
+			}
+			index = node.m_FirstChild;
+		}
+
+		FlatNode& leaf = m_Nodes[index];
+		leaf.m_eStatus = BH_RUNNING;
+		leaf.m_pBehavior->m_eStatus = BH_INVALID;
+		m_ActiveLeaf = index;
+	}
+
+	inline void BehaviorTree::tickNodes()
+	{
+		while (m_ActiveLeaf != BH_NO_NODE)
+		{
+			unsigned index = m_ActiveLeaf;
+			Behavior& leaf = *m_Nodes[index].m_pBehavior;
+
+			// Suspended leaves wait until something wakes them up
+			if (leaf.m_eStatus == BH_SUSPENDED)
+			{
+				return;
+			}
+			Status status = leaf.tick();
+			if (status != BH_SUCCESS && status != BH_FAILURE)
+			{
+				m_Nodes[index].m_eStatus = status;
+				return;
+			}
+
+			// Finishing the leaf activates the next one, unless the root finished
+			m_ActiveLeaf = BH_NO_NODE;
+			completeNode(index, status);
+		}
+	}
+
+	inline void BehaviorTree::completeNode(unsigned index, Status status)
+	{
+		while (true)
+		{
+			FlatNode& node = m_Nodes[index];
+			node.m_eStatus = status;
+			node.m_pBehavior->m_eStatus = status;
+
+			if (node.m_Parent == BH_NO_NODE)
+			{
+				if (!node.m_pBehavior->m_Observer.empty())
+				{
+					node.m_pBehavior->m_Observer();
+				}
+				return;
+			}
+
+			FlatNode& parent = m_Nodes[node.m_Parent];
+			bool finished = (parent.m_eType == NODE_SEQUENCE) ? (status == BH_FAILURE) : (status != BH_FAILURE);
+			if (!finished && ++parent.m_Current < parent.m_ChildCount)
+			{
+				startNode(parent.m_FirstChild + parent.m_Current);
+				return;
+			}
+
+			// The parent ends with the status of its last child.
+			index = node.m_Parent;
+		}
+	}
+
+	/******************************************************************************/
 }
 #endif // !defined (BEHAVIOR_H)
\ No newline at end of file
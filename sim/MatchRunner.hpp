@@ -0,0 +1,184 @@
+#ifndef MATCH_RUNNER_H
+#define MATCH_RUNNER_H
+
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <boost/cstdint.hpp>
+#include "../HartCommander.h"
+#include "../tools/TaskPool.h"
+#include "../tools/Instrumentation.h"
+#include "../tools/Random.h"
+#include "MatchSimulator.hpp"
+
+using namespace std;
+
+/**
+* Outcome of one match played by the runner.
+*/
+struct MatchResult
+{
+	MatchResult() : m_Seed(0) {}
+
+	boost::uint64_t m_Seed;
+	MatchStats m_Stats;
+
+	/**
+	* Latencies of HartCommander::tick() over the match.
+	*/
+	LatencyHistogram m_TickLatency;
+
+	/**
+	* Weight every bot of the commander's team ended the match with, in bot id order.
+	*/
+	vector<int> m_Weights;
+
+	bool isWin() const { return m_Stats.m_Score > m_Stats.m_EnemyScore; }
+	bool isLoss() const { return m_Stats.m_Score < m_Stats.m_EnemyScore; }
+};
+
+/**
+* Plays many independent simulated matches of HartCommander in parallel.
+* Every match gets its own simulator, commander (and so planer) and seed, derived from
+* the run seed and the index of the match. The outcome of every match, timings aside,
+* reproduces for the same run seed whatever the number of threads, as long as HART_PROFILES
+* is not set. With a profile file the matches share it: each one starts from the profiles
+* the matches before it saved, which depends on the order they happen to end in.
+*/
+class MatchRunner
+{
+public:
+	MatchRunner(const MatchConfig& config, unsigned threads)
+		: m_Config(config), m_Pool(threads), m_Seed(0), m_WallSeconds(0.0) {}
+
+	unsigned getThreadCount() const { return m_Pool.getThreadCount(); }
+
+	/**
+	* Plays the given number of matches, spread over all threads.
+	*/
+	const vector<MatchResult>& run(size_t matches, boost::uint64_t seed)
+	{
+		typedef chrono::steady_clock Clock;
+
+		m_Seed = seed;
+		m_Results.assign(matches, MatchResult());
+
+		Clock::time_point start = Clock::now();
+		m_Pool.run(matches, TaskPool::Task(this, &MatchRunner::runMatch));
+		m_WallSeconds = chrono::duration<double>(Clock::now() - start).count();
+		return m_Results;
+	}
+
+	const vector<MatchResult>& getResults() const { return m_Results; }
+
+	/**
+	* Seed of a match of the run, to replay it on its own.
+	*/
+	static boost::uint64_t matchSeed(boost::uint64_t seed, size_t match)
+	{
+		return Random(seed, match).next();
+	}
+
+	/**
+	* Writes the aggregated outcome of the last run: results, throughput, tick latencies and weights,
+	* then the seed of every lost match to replay it.
+	*/
+	void dump(ostream& out) const
+	{
+		size_t wins = 0;
+		size_t losses = 0;
+		int score = 0;
+		int enemyScore = 0;
+		size_t ticks = 0;
+		size_t commands = 0;
+		double commanderSeconds = 0.0;
+		LatencyHistogram latency;
+		double weightSum = 0.0;
+		size_t weightCount = 0;
+		double winWeightSum = 0.0;
+		size_t winWeightCount = 0;
+
+		for (auto iter = m_Results.begin(); iter != m_Results.end(); ++iter)
+		{
+			wins += iter->isWin() ? 1 : 0;
+			losses += iter->isLoss() ? 1 : 0;
+			score += iter->m_Stats.m_Score;
+			enemyScore += iter->m_Stats.m_EnemyScore;
+			ticks += iter->m_Stats.m_Ticks;
+			commands += iter->m_Stats.m_Commands;
+			commanderSeconds += iter->m_Stats.m_CommanderSeconds;
+			latency.merge(iter->m_TickLatency);
+
+			for (auto weight = iter->m_Weights.begin(); weight != iter->m_Weights.end(); ++weight)
+			{
+				weightSum += *weight;
+				weightCount++;
+				if (iter->isWin())
+				{
+					winWeightSum += *weight;
+					winWeightCount++;
+				}
+			}
+		}
+
+		out << fixed << setprecision(1)
+			<< "matches         " << m_Results.size() << " on " << getThreadCount() << " threads in " << m_WallSeconds << "s" << endl
+			<< "won/drawn/lost  " << wins << "/" << (m_Results.size() - wins - losses) << "/" << losses << endl
+			<< "score           " << score << " : " << enemyScore << endl
+			<< "ticks/s         " << (commanderSeconds > 0.0 ? ticks / commanderSeconds : 0.0) << " per commander" << endl
+			<< "commands/s      " << (commanderSeconds > 0.0 ? commands / commanderSeconds : 0.0) << " per commander" << endl
+			<< "matches/s       " << (m_WallSeconds > 0.0 ? m_Results.size() / m_WallSeconds : 0.0) << endl
+			<< "tick us         mean " << latency.getMean() / 1000.0 << " p50 " << latency.getPercentile(0.5) / 1000.0
+			<< " p99 " << latency.getPercentile(0.99) / 1000.0 << " max " << latency.getMax() / 1000.0 << endl
+			<< "weight          mean " << (weightCount > 0 ? weightSum / weightCount : 0.0)
+			<< " in won matches " << (winWeightCount > 0 ? winWeightSum / winWeightCount : 0.0) << endl;
+
+		for (auto iter = m_Results.begin(); iter != m_Results.end(); ++iter)
+		{
+			if (iter->isLoss())
+			{
+				out << "lost            seed " << iter->m_Seed << " " << iter->m_Stats.m_Score << " : " << iter->m_Stats.m_EnemyScore << endl;
+			}
+		}
+	}
+
+private:
+	MatchConfig m_Config;
+	TaskPool m_Pool;
+	boost::uint64_t m_Seed;
+	vector<MatchResult> m_Results;
+	double m_WallSeconds;
+
+	/**
+	* Plays one match, only ever touching its own result.
+	*/
+	void runMatch(size_t index)
+	{
+		MatchResult& result = m_Results[index];
+		result.m_Seed = matchSeed(m_Seed, index);
+
+		MatchConfig config = m_Config;
+		config.m_Seed = result.m_Seed;
+		MatchSimulator simulator(config);
+
+		HartCommander commander;
+		commander.setCommandSink(&simulator);
+		commander.setMatchSeed(result.m_Seed);
+		commander.getInstrumentation().setEnabled(true);
+
+		result.m_Stats = simulator.run(commander);
+		result.m_TickLatency = commander.getInstrumentation().getStage(Instrumentation::STAGE_COMMANDER);
+
+		const StrategyPlaner& planer = *commander.getPlaner();
+		for (BotId id = 0; id < commander.m_bots.size(); id++)
+		{
+			if (commander.m_bots.isOwnTeam(id))
+			{
+				result.m_Weights.push_back(planer.getCurrentWeight(id));
+			}
+		}
+	}
+};
+
+#endif // !defined (MATCH_RUNNER_H)
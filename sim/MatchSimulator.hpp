@@ -0,0 +1,663 @@
+#ifndef MATCH_SIMULATOR_H
+#define MATCH_SIMULATOR_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+#include "../../../api/GameInfo.h"
+#include "../../../api/Commander.h"
+#include "../CommandBatch.hpp"
+#include "../BotRegistry.hpp"
+#include "../SpatialGrid.hpp"
+#include "../tools/Random.h"
+
+using namespace std;
+
+/**
+* Settings of a simulated match.
+*/
+struct MatchConfig
+{
+	MatchConfig()
+		: m_Seed(0), m_BotsPerTeam(5), m_Width(88), m_Height(50), m_TimeStep(0.1f), m_Speed(0.0f),
+		m_GameLength(180.0f), m_RespawnTime(15.0f), m_KillRate(0.5f), m_Obstacles(0.1f) {}
+
+	/**
+	* Seeds the level, the enemy team and the combat, the same seed plays the same match.
+	*/
+	boost::uint64_t m_Seed;
+	unsigned m_BotsPerTeam;
+	int m_Width;
+	int m_Height;
+
+	/**
+	* Simulated seconds per tick.
+	*/
+	float m_TimeStep;
+
+	/**
+	* Multiple of real time the match is played at, 0 plays it as fast as possible.
+	*/
+	float m_Speed;
+
+	float m_GameLength;
+	float m_RespawnTime;
+
+	/**
+	* Chance per second of a bot to shoot down an enemy in firing distance.
+	*/
+	float m_KillRate;
+
+	/**
+	* Fraction of blocked cells of the level.
+	*/
+	float m_Obstacles;
+};
+
+/**
+* Outcome and throughput of a simulated match.
+*/
+struct MatchStats
+{
+	MatchStats()
+		: m_Ticks(0), m_Commands(0), m_Kills(0), m_Captures(0), m_Score(0), m_EnemyScore(0),
+		m_CommanderSeconds(0.0), m_WallSeconds(0.0) {}
+
+	size_t m_Ticks;
+	size_t m_Commands;
+	size_t m_Kills;
+	size_t m_Captures;
+	int m_Score;
+	int m_EnemyScore;
+
+	/**
+	* Time spent in Commander::tick() and for the whole match.
+	*/
+	double m_CommanderSeconds;
+	double m_WallSeconds;
+
+	double getTicksPerSecond() const { return m_CommanderSeconds > 0.0 ? m_Ticks / m_CommanderSeconds : 0.0; }
+	double getCommandsPerSecond() const { return m_CommanderSeconds > 0.0 ? m_Commands / m_CommanderSeconds : 0.0; }
+};
+
+/**
+* Headless, deterministic stand-in for the CTF game server.
+* It fills GameInfo and LevelInfo like the server does and drives a commander through a whole match.
+*
+* The commander plays the blue team and sends its commands as batches to the simulator,
+* a scripted red team plays against it. The model is deliberately simple: bots walk
+* straight to their targets ignoring blocks, shoot enemies within firing distance at random,
+* pick up flags by touching them and score by bringing them to their score location.
+* Dead bots respawn in waves.
+*
+* Bot ids of the batches are the ones of a BotRegistry over the simulated GameInfo.
+*/
+class MatchSimulator : public CommandSink
+{
+public:
+	MatchSimulator(const MatchConfig& config = MatchConfig())
+		: m_Config(config) {}
+
+	const MatchConfig& getConfig() const { return m_Config; }
+	GameInfo& getGame() { return m_Game; }
+	LevelInfo& getLevel() { return m_Level; }
+	const MatchStats& getStats() const { return m_Stats; }
+
+	/**
+	* Plays a whole match with the given commander, which must send its commands to this simulator.
+	*/
+	MatchStats run(Commander& commander)
+	{
+		typedef chrono::steady_clock Clock;
+
+		setUp();
+		commander.m_game = &m_Game;
+		commander.m_level = &m_Level;
+		commander.initialize();
+
+		Clock::time_point start = Clock::now();
+		while (!isOver())
+		{
+			step();
+
+			Clock::time_point tickStart = Clock::now();
+			commander.tick();
+			m_Stats.m_CommanderSeconds += chrono::duration<double>(Clock::now() - tickStart).count();
+
+			if (m_Config.m_Speed > 0.0f)
+			{
+				// Waits for the time the next tick is due
+				double due = m_Stats.m_Ticks * m_Config.m_TimeStep / m_Config.m_Speed;
+				double ahead = due - chrono::duration<double>(Clock::now() - start).count();
+				if (ahead > 0.0)
+				{
+					boost::this_thread::sleep(boost::posix_time::microseconds((boost::int64_t)(ahead * 1e6)));
+				}
+			}
+		}
+		commander.shutdown();
+
+		m_Stats.m_WallSeconds = chrono::duration<double>(Clock::now() - start).count();
+		return m_Stats;
+	}
+
+	/**
+	* Builds level and teams and spawns every bot, the match starts with a respawn event per bot.
+	*/
+	void setUp()
+	{
+		m_Random = Random(m_Config.m_Seed);
+		m_Stats = MatchStats();
+		m_NextRespawn = m_Config.m_RespawnTime;
+		setUpLevel();
+		setUpGame();
+
+		m_Bots.clear();
+		for (auto iter = m_Game.bots.begin(); iter != m_Game.bots.end(); ++iter)
+		{
+			m_Bots.push_back(iter->second.get());
+		}
+		m_Orders.assign(m_Bots.size(), Order());
+
+		for (BotId id = 0; id < m_Bots.size(); id++)
+		{
+			spawn(id);
+		}
+		updateLists();
+	}
+
+	/**
+	* Advances the match by one time step.
+	*/
+	void step()
+	{
+		float dt = m_Config.m_TimeStep;
+		MatchInfo& match = *m_Game.match;
+		m_Stats.m_Ticks++;
+		// Computed from the tick count, summing up the steps would drift
+		match.timePassed = m_Stats.m_Ticks * dt;
+		match.timeRemaining = m_Config.m_GameLength - match.timePassed;
+		match.timeToNextRespawn = m_NextRespawn - match.timePassed;
+
+		if (match.timePassed >= m_NextRespawn)
+		{
+			respawnWave();
+			m_NextRespawn += m_Config.m_RespawnTime;
+		}
+
+		orderEnemies();
+		for (BotId id = 0; id < m_Bots.size(); id++)
+		{
+			move(id, dt);
+		}
+		for (BotId id = 0; id < m_Bots.size(); id++)
+		{
+			touchFlags(id);
+		}
+		combat(dt);
+		updateLists();
+	}
+
+	bool isOver() const { return m_Stats.m_Ticks >= getTickCount(); }
+
+	/**
+	* Ticks of a whole match.
+	*/
+	size_t getTickCount() const { return (size_t)(m_Config.m_GameLength / m_Config.m_TimeStep + 0.5f); }
+
+	/**
+	* Orders of the blue team.
+	*/
+	virtual void flush(const CommandBatch& batch)
+	{
+		CommandBatch::Reader reader(batch);
+		while (reader.next(m_Command))
+		{
+			m_Stats.m_Commands++;
+			if (m_Command.m_BotId >= m_Bots.size() || !isAlive(m_Command.m_BotId))
+			{
+				continue;
+			}
+			bool charge = m_Command.m_Kind == CommandBatch::KIND_CHARGE;
+			order(m_Command.m_BotId, m_Command.m_Target, charge);
+		}
+	}
+
+private:
+	struct Order
+	{
+		Order() : m_Active(false), m_Speed(0.0f) {}
+
+		bool m_Active;
+		Vector2 m_Target;
+		float m_Speed;
+	};
+
+	MatchConfig m_Config;
+	Random m_Random;
+	GameInfo m_Game;
+	LevelInfo m_Level;
+	MatchStats m_Stats;
+
+	/**
+	* Free cells of the level, random spots of the red team are drawn from them.
+	*/
+	SpatialGrid m_Grid;
+	float m_NextRespawn;
+
+	/**
+	* Bots and their orders, indexed by bot id.
+	*/
+	vector<BotInfo*> m_Bots;
+	vector<Order> m_Orders;
+
+	BatchedCommand m_Command;
+
+	static const char* teamName(int team) { return team == 0 ? "Blue" : "Red"; }
+
+	void setUpLevel()
+	{
+		int width = m_Config.m_Width;
+		int height = m_Config.m_Height;
+		m_Level.width = width;
+		m_Level.height = height;
+		m_Level.characterRadius = 0.25f;
+		m_Level.walkingSpeed = 3.0f;
+		m_Level.runningSpeed = 6.0f;
+		m_Level.FOVangle = 1.57f;
+		m_Level.firingDistance = 15.0f;
+		m_Level.gameLength = m_Config.m_GameLength;
+		m_Level.initializationTime = 0.0f;
+		m_Level.respawnTime = m_Config.m_RespawnTime;
+
+		m_Level.teamNames.clear();
+		m_Level.flagSpawnLocations.clear();
+		m_Level.flagScoreLocations.clear();
+		m_Level.botSpawnAreas.clear();
+		for (int team = 0; team < 2; team++)
+		{
+			// Blue on the left, red mirrored on the right
+			float side = team == 0 ? 0.0f : (float)width;
+			float sign = team == 0 ? 1.0f : -1.0f;
+			float middle = height * 0.5f;
+			Vector2 corner(side + sign * 2.0f, middle - 4.0f);
+			Vector2 opposite(side + sign * 6.0f, middle + 4.0f);
+
+			m_Level.teamNames.push_back(teamName(team));
+			m_Level.flagSpawnLocations[teamName(team)] = Vector2(side + sign * width * 0.15f, middle);
+			m_Level.flagScoreLocations[teamName(team)] = Vector2(side + sign * width * 0.1f, middle);
+			m_Level.botSpawnAreas[teamName(team)] = make_pair(
+				Vector2(min(corner.x, opposite.x), corner.y), Vector2(max(corner.x, opposite.x), opposite.y));
+		}
+
+		m_Level.blockHeights.assign(width, vector<float>(height, 0.0f));
+		for (int x = 0; x < width; x++)
+		{
+			for (int y = 0; y < height; y++)
+			{
+				if (m_Random.nextFloat() < m_Config.m_Obstacles && !isBase(Vector2(x + 0.5f, y + 0.5f)))
+				{
+					m_Level.blockHeights[x][y] = m_Random.nextBool() ? 1.0f : 2.0f;
+				}
+			}
+		}
+		m_Grid.build(m_Level);
+	}
+
+	/**
+	* Spawn areas, flags and score locations are kept free of blocks.
+	*/
+	bool isBase(const Vector2& position) const
+	{
+		for (auto iter = m_Level.botSpawnAreas.begin(); iter != m_Level.botSpawnAreas.end(); ++iter)
+		{
+			const pair<Vector2, Vector2>& area = iter->second;
+			if (position.x >= area.first.x - 1.0f && position.x <= area.second.x + 1.0f
+				&& position.y >= area.first.y - 1.0f && position.y <= area.second.y + 1.0f)
+			{
+				return true;
+			}
+		}
+		for (auto iter = m_Level.teamNames.begin(); iter != m_Level.teamNames.end(); ++iter)
+		{
+			if (position.distance(m_Level.flagSpawnLocations.find(*iter)->second) < 2.0f
+				|| position.distance(m_Level.flagScoreLocations.find(*iter)->second) < 2.0f)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void setUpGame()
+	{
+		m_Game.match.reset(new MatchInfo());
+		m_Game.match->timeRemaining = m_Config.m_GameLength;
+		m_Game.match->timePassed = 0.0f;
+		m_Game.match->timeToNextRespawn = m_Config.m_RespawnTime;
+		m_Game.teams.clear();
+		m_Game.flags.clear();
+		m_Game.bots.clear();
+
+		for (int team = 0; team < 2; team++)
+		{
+			string name = teamName(team);
+			m_Game.match->scores[name] = 0;
+
+			unique_ptr<TeamInfo> info(new TeamInfo());
+			info->name = name;
+			info->flagScoreLocation = m_Level.flagScoreLocations[name];
+			info->flagSpawnLocation = m_Level.flagSpawnLocations[name];
+			info->botSpawnArea = m_Level.botSpawnAreas[name];
+
+			unique_ptr<FlagInfo> flag(new FlagInfo());
+			flag->name = name + "Flag";
+			flag->team = info.get();
+			flag->position = info->flagSpawnLocation;
+			flag->carrier = NULL;
+			flag->respawnTimer = 0.0f;
+			info->flag = flag.get();
+
+			for (unsigned i = 0; i < m_Config.m_BotsPerTeam; i++)
+			{
+				unique_ptr<BotInfo> bot(new BotInfo());
+				bot->name = name + to_string(i);
+				bot->team = info.get();
+				bot->flag = NULL;
+				bot->health = 0.0f;
+				bot->state = BotInfo::STATE_DEAD;
+				info->members.push_back(bot.get());
+				m_Game.bots[bot->name] = std::move(bot);
+			}
+
+			m_Game.flags[flag->name] = std::move(flag);
+			m_Game.teams[name] = std::move(info);
+		}
+		m_Game.team = m_Game.teams["Blue"].get();
+		m_Game.enemyTeam = m_Game.teams["Red"].get();
+	}
+
+	bool isAlive(BotId id) const { return *m_Bots[id]->health > 0.0f; }
+	bool isBlue(BotId id) const { return m_Bots[id]->team == m_Game.team; }
+
+	const TeamInfo& enemyOf(const TeamInfo& team) const
+	{
+		return &team == m_Game.team ? *m_Game.enemyTeam : *m_Game.team;
+	}
+
+	void addEvent(MatchCombatEvent& event)
+	{
+		event.time = m_Game.match->timePassed;
+		m_Game.match->combatEvents.push_back(event);
+	}
+
+	/**
+	* Uniform random cell center inside the box that is not blocked, the box center if there is none.
+	*/
+	Vector2 randomFreePosition(const Vector2& min, const Vector2& max)
+	{
+		for (int attempt = 0; attempt < 32; attempt++)
+		{
+			Vector2 position(min.x + (max.x - min.x) * m_Random.nextFloat(), min.y + (max.y - min.y) * m_Random.nextFloat());
+			int x = (int)position.x;
+			int y = (int)position.y;
+			if (x >= 0 && y >= 0 && x < m_Level.width && y < m_Level.height && m_Level.blockHeights[x][y] == 0.0f)
+			{
+				return position;
+			}
+		}
+		return (min + max) * 0.5f;
+	}
+
+	void spawn(BotId id)
+	{
+		BotInfo& bot = *m_Bots[id];
+		const pair<Vector2, Vector2>& area = bot.team->botSpawnArea;
+		bot.position = randomFreePosition(area.first, area.second);
+		bot.facingDirection = Vector2(isBlue(id) ? 1.0f : -1.0f, 0.0f);
+		bot.health = 100.0f;
+		bot.state = BotInfo::STATE_IDLE;
+		bot.seenlast = 0.0f;
+		m_Orders[id] = Order();
+
+		MatchCombatEvent event = MatchCombatEvent();
+		event.type = MatchCombatEvent::TYPE_RESPAWN;
+		event.respawnEventData.subject = &bot;
+		addEvent(event);
+	}
+
+	void respawnWave()
+	{
+		for (BotId id = 0; id < m_Bots.size(); id++)
+		{
+			if (!isAlive(id))
+			{
+				spawn(id);
+			}
+		}
+	}
+
+	void order(BotId id, const Vector2& target, bool charge)
+	{
+		Order& order = m_Orders[id];
+		order.m_Active = true;
+		order.m_Target = Vector2(
+			max(0.0f, min((float)m_Level.width, target.x)),
+			max(0.0f, min((float)m_Level.height, target.y)));
+		order.m_Speed = charge ? m_Level.runningSpeed : m_Level.walkingSpeed;
+		m_Bots[id]->state = charge ? BotInfo::STATE_CHARGING : BotInfo::STATE_ATTACKING;
+	}
+
+	/**
+	* The red team: carriers run home, the others go for the blue flag or a random spot.
+	*/
+	void orderEnemies()
+	{
+		for (BotId id = 0; id < m_Bots.size(); id++)
+		{
+			if (isBlue(id) || !isAlive(id) || m_Orders[id].m_Active)
+			{
+				continue;
+			}
+
+			const BotInfo& bot = *m_Bots[id];
+			if (bot.flag != NULL)
+			{
+				order(id, bot.team->flagScoreLocation, true);
+			} else if (m_Random.nextBool())
+			{
+				order(id, m_Game.team->flag->position, true);
+			} else
+			{
+				Vector2 target = *bot.position;
+				m_Grid.findRandomFreePosition(m_Random, target);
+				order(id, target, false);
+			}
+		}
+	}
+
+	void move(BotId id, float dt)
+	{
+		Order& order = m_Orders[id];
+		if (!order.m_Active || !isAlive(id))
+		{
+			return;
+		}
+
+		BotInfo& bot = *m_Bots[id];
+		Vector2 direction = order.m_Target - *bot.position;
+		float distance = direction.length();
+		float stride = order.m_Speed * dt;
+		if (distance <= stride)
+		{
+			bot.position = order.m_Target;
+			bot.state = BotInfo::STATE_IDLE;
+			order.m_Active = false;
+		} else
+		{
+			direction = direction / distance;
+			bot.position = *bot.position + direction * stride;
+			bot.facingDirection = direction;
+		}
+
+		if (bot.flag != NULL)
+		{
+			bot.flag->position = *bot.position;
+		}
+	}
+
+	void touchFlags(BotId id)
+	{
+		if (!isAlive(id))
+		{
+			return;
+		}
+
+		BotInfo& bot = *m_Bots[id];
+		FlagInfo& enemyFlag = *enemyOf(*bot.team).flag;
+		FlagInfo& ownFlag = *bot.team->flag;
+		MatchCombatEvent event = MatchCombatEvent();
+
+		if (bot.flag == NULL && enemyFlag.carrier == NULL && bot.position->distance(enemyFlag.position) < 1.0f)
+		{
+			enemyFlag.carrier = &bot;
+			bot.flag = &enemyFlag;
+			event.type = MatchCombatEvent::TYPE_FLAG_PICKEDUP;
+			event.flagPickedupEventData.instigator = &bot;
+			event.flagPickedupEventData.subject = &enemyFlag;
+			addEvent(event);
+		}
+
+		if (bot.flag != NULL && bot.position->distance(bot.team->flagScoreLocation) < 1.0f)
+		{
+			m_Game.match->scores[bot.team->name]++;
+			m_Stats.m_Captures++;
+			if (bot.team == m_Game.team)
+			{
+				m_Stats.m_Score++;
+			} else
+			{
+				m_Stats.m_EnemyScore++;
+			}
+			event.type = MatchCombatEvent::TYPE_FLAG_CAPTURED;
+			event.flagCapturedEventData.instigator = &bot;
+			event.flagCapturedEventData.subject = bot.flag;
+			addEvent(event);
+			restore(*bot.flag);
+		}
+
+		// A dropped flag goes home when its own team touches it
+		if (ownFlag.carrier == NULL && ownFlag.position != bot.team->flagSpawnLocation
+			&& bot.position->distance(ownFlag.position) < 1.0f)
+		{
+			restore(ownFlag);
+		}
+	}
+
+	void restore(FlagInfo& flag)
+	{
+		if (flag.carrier != NULL)
+		{
+			flag.carrier->flag = NULL;
+			flag.carrier = NULL;
+		}
+		flag.position = flag.team->flagSpawnLocation;
+
+		MatchCombatEvent event = MatchCombatEvent();
+		event.type = MatchCombatEvent::TYPE_FLAG_RESTORED;
+		event.flagRestoredEventData.subject = &flag;
+		addEvent(event);
+	}
+
+	void kill(BotId id, BotInfo& instigator)
+	{
+		BotInfo& bot = *m_Bots[id];
+		bot.health = 0.0f;
+		bot.state = BotInfo::STATE_DEAD;
+		m_Orders[id] = Order();
+		m_Stats.m_Kills++;
+
+		MatchCombatEvent event = MatchCombatEvent();
+		event.type = MatchCombatEvent::TYPE_KILLED;
+		event.killedEventData.instigator = &instigator;
+		event.killedEventData.subject = &bot;
+		addEvent(event);
+
+		if (bot.flag != NULL)
+		{
+			FlagInfo& flag = *bot.flag;
+			flag.carrier = NULL;
+			bot.flag = NULL;
+			event.type = MatchCombatEvent::TYPE_FLAG_DROPPED;
+			event.flagDroppedEventData.instigator = &bot;
+			event.flagDroppedEventData.subject = &flag;
+			addEvent(event);
+		}
+	}
+
+	/**
+	* Every bot sees the enemies within firing distance and may shoot one of them.
+	*/
+	void combat(float dt)
+	{
+		for (BotId id = 0; id < m_Bots.size(); id++)
+		{
+			m_Bots[id]->visibleEnemies.clear();
+			m_Bots[id]->seenBy.clear();
+		}
+
+		float range = m_Level.firingDistance * m_Level.firingDistance;
+		float chance = m_Config.m_KillRate * dt;
+		for (BotId id = 0; id < m_Bots.size(); id++)
+		{
+			if (!isAlive(id))
+			{
+				continue;
+			}
+			BotInfo& bot = *m_Bots[id];
+			for (BotId other = 0; other < m_Bots.size(); other++)
+			{
+				BotInfo& enemy = *m_Bots[other];
+				if (enemy.team == bot.team || !isAlive(other) || bot.position->squaredDistance(*enemy.position) > range)
+				{
+					continue;
+				}
+				bot.visibleEnemies.push_back(&enemy);
+				enemy.seenBy.push_back(&bot);
+				enemy.seenlast = 0.0f;
+				if (m_Random.nextFloat() < chance)
+				{
+					bot.state = BotInfo::STATE_SHOOTING;
+					kill(other, bot);
+					break;
+				}
+			}
+		}
+	}
+
+	/**
+	* The alive and available bots of the blue team, available meaning done with their orders.
+	*/
+	void updateLists()
+	{
+		m_Game.bots_alive.clear();
+		m_Game.bots_available.clear();
+		for (BotId id = 0; id < m_Bots.size(); id++)
+		{
+			if (!isBlue(id) || !isAlive(id))
+			{
+				continue;
+			}
+			m_Game.bots_alive.push_back(m_Bots[id]);
+			if (!m_Orders[id].m_Active)
+			{
+				m_Game.bots_available.push_back(m_Bots[id]);
+			}
+		}
+	}
+};
+
+#endif // !defined (MATCH_SIMULATOR_H)
@@ -0,0 +1,90 @@
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include "../HartCommander.h"
+#include "MatchSimulator.hpp"
+#include "MatchRunner.hpp"
+
+using namespace std;
+
+static void usage()
+{
+	cout << "simulate [--bots n] [--seed n] [--length seconds] [--step seconds] [--speed factor] [--width n] [--height n]" << endl
+		<< "         [--matches n] [--threads n]" << endl
+		<< "  Plays headless matches of HartCommander against a scripted team." << endl
+		<< "  A speed of 0 (the default) plays as fast as possible, 1 in real time." << endl
+		<< "  More than one match are played in parallel on all cores unless threads are given." << endl
+		<< "  The same seed plays the same matches, unless they share profiles through HART_PROFILES." << endl
+		<< "  A match of a run replays on its own with the seed the run lists for it." << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	MatchConfig config;
+	size_t matches = 1;
+	unsigned threads = boost::thread::hardware_concurrency();
+	for (int i = 1; i < argc; i++)
+	{
+		const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+		if (value != NULL && strcmp(argv[i], "--bots") == 0)
+		{
+			config.m_BotsPerTeam = atoi(value);
+		} else if (value != NULL && strcmp(argv[i], "--seed") == 0)
+		{
+			config.m_Seed = strtoull(value, NULL, 10);
+		} else if (value != NULL && strcmp(argv[i], "--length") == 0)
+		{
+			config.m_GameLength = (float)atof(value);
+		} else if (value != NULL && strcmp(argv[i], "--step") == 0)
+		{
+			config.m_TimeStep = (float)atof(value);
+		} else if (value != NULL && strcmp(argv[i], "--speed") == 0)
+		{
+			config.m_Speed = (float)atof(value);
+		} else if (value != NULL && strcmp(argv[i], "--width") == 0)
+		{
+			config.m_Width = atoi(value);
+		} else if (value != NULL && strcmp(argv[i], "--height") == 0)
+		{
+			config.m_Height = atoi(value);
+		} else if (value != NULL && strcmp(argv[i], "--matches") == 0)
+		{
+			matches = strtoul(value, NULL, 10);
+		} else if (value != NULL && strcmp(argv[i], "--threads") == 0)
+		{
+			threads = atoi(value);
+		} else
+		{
+			usage();
+			return 1;
+		}
+		i++;
+	}
+
+	if (matches > 1)
+	{
+		MatchRunner runner(config, threads);
+		runner.run(matches, config.m_Seed);
+		runner.dump(cout);
+		return 0;
+	}
+
+	MatchSimulator simulator(config);
+	HartCommander commander;
+	commander.setCommandSink(&simulator);
+	commander.setMatchSeed(config.m_Seed);
+	MatchStats stats = simulator.run(commander);
+
+	cout << "seed          " << config.m_Seed << endl
+		<< "score         " << stats.m_Score << " : " << stats.m_EnemyScore << endl
+		<< "ticks         " << stats.m_Ticks << endl
+		<< "commands      " << stats.m_Commands << endl
+		<< "kills         " << stats.m_Kills << endl
+		<< fixed << setprecision(1)
+		<< "ticks/s       " << stats.getTicksPerSecond() << endl
+		<< "commands/s    " << stats.getCommandsPerSecond() << endl
+		<< setprecision(3)
+		<< "wall time     " << stats.m_WallSeconds << "s" << endl;
+	return 0;
+}
@@ -0,0 +1,360 @@
+#include <vector>
+#include <memory>
+#include <cstdlib>
+#include <new>
+#include <boost/atomic.hpp>
+#include "../../bt/Behavior.h"
+#include "benchmark/benchmark.h"
+
+using namespace bt;
+
+/******************************************************************************/
+// Allocation counting, every heap allocation of the process goes through here.
+
+static boost::atomic<size_t> s_Allocations(0);
+
+void* operator new(size_t size)
+{
+	s_Allocations++;
+	void* p = malloc(size > 0 ? size : 1);
+	if (p == NULL)
+	{
+		throw bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+/**
+* Reports ns per step, steps per second and allocations per tick of a benchmark run.
+*/
+static void report(benchmark::State& state, size_t steps, size_t allocations)
+{
+	state.SetItemsProcessed(steps);
+	state.counters["step"] = benchmark::Counter((double)steps, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+	state.counters["allocs/tick"] = benchmark::Counter((double)allocations / state.iterations());
+}
+
+/******************************************************************************/
+// Synthetic leaves
+
+/**
+* Finishes on every update with a fixed status.
+*/
+class ConstantLeaf : public Behavior
+{
+public:
+	ConstantLeaf(Status status) : m_Result(status), m_Updates(0) {}
+
+	Status update()
+	{
+		m_Updates++;
+		return m_Result;
+	}
+
+	Status m_Result;
+	size_t m_Updates;
+};
+
+/**
+* Model class, like the gun of the demo.
+*/
+class Gun
+{
+public:
+	Gun() : m_Bullets(6) {}
+	int m_Bullets;
+};
+
+/**
+* Aims for one tick, then fires a bullet or fails on an empty magazine.
+*/
+class FireGun : public Behavior
+{
+public:
+	FireGun(Gun& gun) : m_pGun(&gun), m_Aimed(false) {}
+
+	void onInitialize() { m_Aimed = false; }
+
+	Status update()
+	{
+		if (!m_Aimed)
+		{
+			m_Aimed = true;
+			return BH_RUNNING;
+		}
+		if (m_pGun->m_Bullets == 0)
+		{
+			return BH_FAILURE;
+		}
+		m_pGun->m_Bullets--;
+		return BH_SUCCESS;
+	}
+
+private:
+	Gun* m_pGun;
+	bool m_Aimed;
+};
+
+/**
+* Waits suspended for ammunition, someone else resumes it by setting it running again.
+*/
+class ReloadGun : public Behavior
+{
+public:
+	ReloadGun(Gun& gun) : m_pGun(&gun) {}
+
+	Status update()
+	{
+		if (m_eStatus != BH_RUNNING)
+		{
+			return BH_SUSPENDED;
+		}
+		m_pGun->m_Bullets = 6;
+		return BH_SUCCESS;
+	}
+
+private:
+	Gun* m_pGun;
+};
+
+/******************************************************************************/
+// Synthetic trees
+
+/**
+* Owns all behaviors of one synthetic tree.
+*/
+class TreeBuilder
+{
+public:
+	TreeBuilder(BehaviorTree& bt) : m_pTree(&bt) {}
+
+	Sequence* sequence()
+	{
+		Sequence* sequence = new Sequence(*m_pTree);
+		m_Behaviors.push_back(unique_ptr<Behavior>(sequence));
+		return sequence;
+	}
+
+	Selector* selector()
+	{
+		Selector* selector = new Selector(*m_pTree);
+		m_Behaviors.push_back(unique_ptr<Behavior>(selector));
+		return selector;
+	}
+
+	template <typename T>
+	T* leaf(T* behavior)
+	{
+		m_Behaviors.push_back(unique_ptr<Behavior>(behavior));
+		return behavior;
+	}
+
+	/**
+	* Sequence of depth levels, every level holds one leaf and the next level.
+	*/
+	Behavior* deepSequence(int depth)
+	{
+		Sequence* root = sequence();
+		Sequence* current = root;
+		for (int i = 1; i < depth; i++)
+		{
+			current->add(leaf(new ConstantLeaf(BH_SUCCESS)));
+			Sequence* next = sequence();
+			current->add(next);
+			current = next;
+		}
+		current->add(leaf(new ConstantLeaf(BH_SUCCESS)));
+		return root;
+	}
+
+	/**
+	* Selector whose children all fail except for the last one.
+	*/
+	Behavior* wideSelector(int width)
+	{
+		Selector* root = selector();
+		for (int i = 1; i < width; i++)
+		{
+			root->add(leaf(new ConstantLeaf(BH_FAILURE)));
+		}
+		root->add(leaf(new ConstantLeaf(BH_SUCCESS)));
+		return root;
+	}
+
+	/**
+	* The demo tree: fire the whole magazine, otherwise wait for a reload.
+	*/
+	Behavior* gunTree(Gun& gun, ReloadGun*& reload)
+	{
+		Sequence* fire = sequence();
+		for (int i = 0; i < 6; i++)
+		{
+			fire->add(leaf(new FireGun(gun)));
+		}
+		reload = leaf(new ReloadGun(gun));
+
+		Selector* root = selector();
+		root->add(fire);
+		root->add(reload);
+		return root;
+	}
+
+private:
+	BehaviorTree* m_pTree;
+	vector<unique_ptr<Behavior> > m_Behaviors;
+};
+
+/******************************************************************************/
+// Benchmarks
+
+/**
+* Runs a whole deep sequence per tick on the compiled layout.
+*/
+static void BM_DeepSequence_Compiled(benchmark::State& state)
+{
+	BehaviorTree bt;
+	TreeBuilder builder(bt);
+	int depth = state.range(0);
+	bt.compile(*builder.deepSequence(depth));
+	bt.reserve(depth);
+	bt.tick();
+
+	size_t allocations = s_Allocations;
+	for (auto _ : state)
+	{
+		bt.restart();
+		bt.tick();
+	}
+	report(state, state.iterations() * depth, s_Allocations - allocations);
+}
+BENCHMARK(BM_DeepSequence_Compiled)->RangeMultiplier(4)->Range(4, 1024);
+
+/**
+* Runs a whole wide selector per tick on the compiled layout.
+*/
+static void BM_WideSelector_Compiled(benchmark::State& state)
+{
+	BehaviorTree bt;
+	TreeBuilder builder(bt);
+	int width = state.range(0);
+	bt.compile(*builder.wideSelector(width));
+	bt.reserve(width);
+	bt.tick();
+
+	size_t allocations = s_Allocations;
+	for (auto _ : state)
+	{
+		bt.restart();
+		bt.tick();
+	}
+	report(state, state.iterations() * width, s_Allocations - allocations);
+}
+BENCHMARK(BM_WideSelector_Compiled)->RangeMultiplier(4)->Range(4, 1024);
+
+static void onRootFinished()
+{
+}
+
+/**
+* Runs a whole wide selector per tick through the composites themselves.
+*/
+static void BM_WideSelector_Dynamic(benchmark::State& state)
+{
+	BehaviorTree bt;
+	TreeBuilder builder(bt);
+	int width = state.range(0);
+	Behavior* root = builder.wideSelector(width);
+	bt.reserve(width + 1);
+
+	// With an observer the suspended root leaves the queue after its first update
+	BehaviorObserver observer(&onRootFinished);
+
+	size_t allocations = s_Allocations;
+	for (auto _ : state)
+	{
+		root->m_eStatus = BH_INVALID;
+		bt.insert(*root, &observer);
+		bt.tick();
+	}
+	// The root plus every child
+	report(state, state.iterations() * (width + 1), s_Allocations - allocations);
+}
+BENCHMARK(BM_WideSelector_Dynamic)->RangeMultiplier(4)->Range(4, 1024);
+
+/**
+* Single steps over a queue of running leaves, the scheduler overhead per behavior.
+*/
+static void BM_Step_Running(benchmark::State& state)
+{
+	BehaviorTree bt;
+	TreeBuilder builder(bt);
+	int leaves = state.range(0);
+	bt.reserve(leaves);
+	for (int i = 0; i < leaves; i++)
+	{
+		bt.insert(*builder.leaf(new ConstantLeaf(BH_RUNNING)));
+	}
+	bt.tick();
+
+	size_t allocations = s_Allocations;
+	for (auto _ : state)
+	{
+		bt.tick();
+	}
+	report(state, state.iterations() * leaves, s_Allocations - allocations);
+}
+BENCHMARK(BM_Step_Running)->RangeMultiplier(4)->Range(4, 1024);
+
+/**
+* One tree per bot, mixing running (aiming) and suspended (reloading) leaves like the demo.
+*/
+static void BM_GunBots_Compiled(benchmark::State& state)
+{
+	int bots = state.range(0);
+	vector<unique_ptr<BehaviorTree> > trees;
+	vector<unique_ptr<TreeBuilder> > builders;
+	vector<unique_ptr<Gun> > guns;
+	vector<ReloadGun*> reloads(bots);
+
+	for (int i = 0; i < bots; i++)
+	{
+		trees.push_back(unique_ptr<BehaviorTree>(new BehaviorTree()));
+		builders.push_back(unique_ptr<TreeBuilder>(new TreeBuilder(*trees.back())));
+		guns.push_back(unique_ptr<Gun>(new Gun()));
+		trees.back()->compile(*builders.back()->gunTree(*guns.back(), reloads[i]));
+		trees.back()->reserve(4);
+	}
+
+	size_t ticks = 0;
+	size_t allocations = s_Allocations;
+	for (auto _ : state)
+	{
+		for (int i = 0; i < bots; i++)
+		{
+			BehaviorTree& bt = *trees[i];
+			if (bt.getNodes()[0].m_eStatus != BH_RUNNING)
+			{
+				bt.restart();
+			}
+			// The ammunition arrives every eighth tick
+			if ((ticks & 7) == 0 && reloads[i]->m_eStatus == BH_SUSPENDED)
+			{
+				reloads[i]->m_eStatus = BH_RUNNING;
+			}
+			bt.tick();
+		}
+		ticks++;
+	}
+	report(state, state.iterations() * bots, s_Allocations - allocations);
+}
+BENCHMARK(BM_GunBots_Compiled)->RangeMultiplier(2)->Range(4, 64);
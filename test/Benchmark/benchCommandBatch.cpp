@@ -0,0 +1,106 @@
+#include <vector>
+#include <string>
+#include "../../../api/Vector2.h"
+#include "../../../api/Commands.h"
+#include "../../CommandPool.hpp"
+#include "../../CommandBatch.hpp"
+#include "../../LocalCommandServer.hpp"
+#include "benchmark/benchmark.h"
+
+/**
+* One tick of commands for the given number of bots, like the planer hands them out.
+*/
+static void makeCommands(CommandPool& pool, vector<const Command*>& commands, int bots)
+{
+	static vector<string> names;
+	for (int i = (int)names.size(); i < bots; i++)
+	{
+		names.push_back("Blue" + to_string(i));
+	}
+
+	pool.reserve(bots);
+	for (int i = 0; i < bots; i++)
+	{
+		const string& name = names[i];
+		Vector2 target(1.5f * i, 80.0f - i);
+		if (i % 2 == 0)
+		{
+			commands.push_back(pool.attack(i, name, target, boost::none, "AttackerDMS: random attack"));
+		} else
+		{
+			commands.push_back(pool.charge(i, name, target, "AttackerDMS: random charge"));
+		}
+	}
+}
+
+/**
+* Emitting a tick and handing the server a copy of every command it owns.
+*/
+static void BM_IssueClones(benchmark::State& state)
+{
+	CommandPool pool;
+	vector<const Command*> commands;
+
+	for (auto _ : state)
+	{
+		commands.clear();
+		makeCommands(pool, commands, state.range(0));
+		for (auto i = commands.begin(); i != commands.end(); ++i)
+		{
+			unique_ptr<Command> issued(CommandPool::clone(**i));
+			benchmark::DoNotOptimize(issued.get());
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_IssueClones)->RangeMultiplier(4)->Range(4, 256);
+
+/**
+* Emitting a tick and handing the server the pooled commands themselves.
+*/
+static void BM_IssueReleased(benchmark::State& state)
+{
+	CommandPool pool;
+	vector<const Command*> commands;
+
+	for (auto _ : state)
+	{
+		commands.clear();
+		makeCommands(pool, commands, state.range(0));
+		for (size_t i = 0; i < commands.size(); i++)
+		{
+			unique_ptr<Command> issued(pool.release(i, *commands[i]));
+			benchmark::DoNotOptimize(issued.get());
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_IssueReleased)->RangeMultiplier(4)->Range(4, 256);
+
+/**
+* Encoding a tick into the batch and flushing it to the local server, which decodes it.
+*/
+static void BM_BatchFlush(benchmark::State& state)
+{
+	CommandPool pool;
+	vector<const Command*> commands;
+	makeCommands(pool, commands, state.range(0));
+
+	CommandBatch batch;
+	batch.setDescriptions(state.range(1) != 0);
+	LocalCommandServer server;
+
+	for (auto _ : state)
+	{
+		batch.clear();
+		for (size_t i = 0; i < commands.size(); i++)
+		{
+			batch.add((BotId)i, *commands[i]);
+		}
+		server.flush(batch);
+	}
+	state.SetItemsProcessed(state.iterations() * commands.size());
+	state.counters["bytes/tick"] = benchmark::Counter((double)batch.getByteSize());
+	state.counters["decode_p50_ns"] = benchmark::Counter((double)server.getDecodeLatency().getPercentile(0.5));
+}
+BENCHMARK(BM_BatchFlush)->ArgsProduct({ benchmark::CreateRange(4, 256, 4), { 0, 1 } });
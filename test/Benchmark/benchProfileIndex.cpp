@@ -0,0 +1,69 @@
+#include <vector>
+#include "../../ProfileIndex.h"
+#include "../../tools/Random.h"
+#include "benchmark/benchmark.h"
+
+using namespace dms;
+
+/**
+* A library of random profiles with the given number of features.
+*/
+static void makeIndex(ProfileIndex& index, size_t profiles, size_t features)
+{
+	Random random(profiles);
+	index.setDimension(features);
+	vector<float> point(features);
+	for (size_t i = 0; i < profiles; i++)
+	{
+		for (size_t axis = 0; axis < features; axis++)
+		{
+			point[axis] = random.nextFloat() * 100.0f;
+		}
+		index.add(&point[0]);
+	}
+}
+
+/**
+* The former way of answering an alert, comparing the internal features with every profile.
+*/
+static void BM_NearestBruteForce(benchmark::State& state)
+{
+	ProfileIndex index;
+	makeIndex(index, state.range(0), state.range(1));
+	vector<float> query(state.range(1), 50.0f);
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(index.findNearestBruteForce(&query[0]));
+	}
+	state.SetItemsProcessed(state.iterations() * index.size());
+}
+BENCHMARK(BM_NearestBruteForce)->ArgsProduct({ benchmark::CreateRange(64, 65536, 8), { 4, 8, 32 } });
+
+static void BM_NearestIndexed(benchmark::State& state)
+{
+	ProfileIndex index;
+	makeIndex(index, state.range(0), state.range(1));
+	index.build();
+	vector<float> query(state.range(1), 50.0f);
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(index.findNearest(&query[0]));
+	}
+	state.SetItemsProcessed(state.iterations() * index.size());
+}
+BENCHMARK(BM_NearestIndexed)->ArgsProduct({ benchmark::CreateRange(64, 65536, 8), { 4, 8, 32 } });
+
+static void BM_Build(benchmark::State& state)
+{
+	ProfileIndex index;
+	makeIndex(index, state.range(0), 8);
+
+	for (auto _ : state)
+	{
+		index.build();
+	}
+	state.SetItemsProcessed(state.iterations() * index.size());
+}
+BENCHMARK(BM_Build)->RangeMultiplier(8)->Range(512, 65536);
@@ -203,3 +203,167 @@ TEST_F(CompositeTest, Sequence) {
 
 	EXPECT_EQ(BH_FAILURE, sequence->m_eStatus);
 }
+
+TEST_F(CompositeTest, CompiledLayout) {
+	MockBehavior bhMock1;
+	MockBehavior bhMock2;
+	MockBehavior bhMock3;
+
+	sequence->add(&bhMock1);
+	sequence->add(&bhMock2);
+	selector->add(sequence);
+	selector->add(&bhMock3);
+
+	bt.compile(*selector);
+
+	const vector<FlatNode>& nodes = bt.getNodes();
+	ASSERT_EQ(5u, nodes.size());
+
+	EXPECT_EQ(NODE_SELECTOR, nodes[0].m_eType);
+	EXPECT_EQ(1u, nodes[0].m_FirstChild);
+	EXPECT_EQ(2u, nodes[0].m_ChildCount);
+
+	EXPECT_EQ(NODE_SEQUENCE, nodes[1].m_eType);
+	EXPECT_EQ(0u, nodes[1].m_Parent);
+	EXPECT_EQ(3u, nodes[1].m_FirstChild);
+	EXPECT_EQ(2u, nodes[1].m_ChildCount);
+
+	EXPECT_EQ(&bhMock3, nodes[2].m_pBehavior);
+	EXPECT_EQ(&bhMock1, nodes[3].m_pBehavior);
+	EXPECT_EQ(1u, nodes[4].m_Parent);
+}
+
+TEST_F(CompositeTest, CompiledSelector) {
+	MockBehavior bhMockTrue;
+	MockBehavior bhMockFalse;
+	bhMockFalse.m_ReturnStatus = BH_FAILURE;
+	MockBehavior bhMockTrue2;
+
+	selector->add(&bhMockFalse);
+	selector->add(&bhMockTrue);
+	selector->add(&bhMockTrue2);
+
+	MockBehavior observed;
+	BehaviorObserver obs(&observed, &MockBehavior::onObserved);
+	bt.compile(*selector, &obs);
+
+	bt.tick();
+
+	EXPECT_EQ(BH_FAILURE, bhMockFalse.m_eStatus);
+	EXPECT_EQ(BH_SUCCESS, bhMockTrue.m_eStatus);
+	EXPECT_EQ(BH_INVALID, bhMockTrue2.m_eStatus);
+	EXPECT_FALSE(bhMockTrue2.m_CalledUpdate);
+
+	EXPECT_EQ(BH_SUCCESS, selector->m_eStatus);
+	EXPECT_EQ(BH_SUCCESS, bt.getNodes()[0].m_eStatus);
+	EXPECT_TRUE(observed.m_CalledObserved);
+}
+
+TEST_F(CompositeTest, CompiledNested) {
+	MockBehavior bhMockTrue;
+	MockBehavior bhMockRunning;
+	bhMockRunning.m_ReturnStatus = BH_RUNNING;
+	MockBehavior bhMockFallback;
+
+	sequence->add(&bhMockTrue);
+	sequence->add(&bhMockRunning);
+	selector->add(sequence);
+	selector->add(&bhMockFallback);
+
+	bt.compile(*selector);
+
+	// The running leaf keeps the whole branch alive across ticks
+	bt.tick();
+	bt.tick();
+
+	EXPECT_EQ(BH_SUCCESS, bhMockTrue.m_eStatus);
+	EXPECT_EQ(BH_RUNNING, bhMockRunning.m_eStatus);
+	EXPECT_EQ(BH_RUNNING, bt.getNodes()[0].m_eStatus);
+	EXPECT_FALSE(bhMockFallback.m_CalledUpdate);
+
+	// Once it fails the selector falls back to its second child within the same tick
+	bhMockRunning.m_ReturnStatus = BH_FAILURE;
+	bt.tick();
+
+	EXPECT_EQ(BH_FAILURE, sequence->m_eStatus);
+	EXPECT_EQ(BH_SUCCESS, bhMockFallback.m_eStatus);
+	EXPECT_EQ(BH_SUCCESS, selector->m_eStatus);
+}
+
+TEST_F(CompositeTest, Recompile) {
+	MockBehavior bhMockRunning;
+	bhMockRunning.m_ReturnStatus = BH_RUNNING;
+	MockBehavior bhMockTrue;
+
+	sequence->add(&bhMockRunning);
+	bt.compile(*sequence);
+	bt.tick();
+	EXPECT_TRUE(bhMockRunning.m_CalledUpdate);
+
+	// The running leaf of the previous tree is dropped, its behaviors no longer belong to a compiled tree
+	selector->add(&bhMockTrue);
+	bt.compile(*selector);
+	EXPECT_EQ(BH_NO_NODE, sequence->m_NodeIndex);
+	EXPECT_EQ(BH_NO_NODE, bhMockRunning.m_NodeIndex);
+	EXPECT_EQ(1u, bhMockTrue.m_NodeIndex);
+
+	bhMockRunning.m_CalledUpdate = false;
+	bt.tick();
+	EXPECT_FALSE(bhMockRunning.m_CalledUpdate);
+	EXPECT_EQ(BH_SUCCESS, selector->m_eStatus);
+
+	// Finished, until restarted
+	bhMockTrue.m_CalledUpdate = false;
+	bt.tick();
+	EXPECT_FALSE(bhMockTrue.m_CalledUpdate);
+	bt.restart();
+	bt.tick();
+	EXPECT_TRUE(bhMockTrue.m_CalledUpdate);
+}
+
+TEST(BehaviorTreeTest, TickRunningKeepsQueue) {
+	BehaviorTree bt;
+	bt.reserve(4);
+
+	MockBehavior running;
+	running.m_ReturnStatus = BH_RUNNING;
+	MockBehavior other;
+	other.m_ReturnStatus = BH_RUNNING;
+	bt.insert(running);
+	bt.insert(other);
+
+	// Each tick updates every active behavior exactly once
+	for (int i = 0; i < 100; i++)
+	{
+		running.m_CalledUpdate = false;
+		other.m_CalledUpdate = false;
+		bt.tick();
+		EXPECT_TRUE(running.m_CalledUpdate);
+		EXPECT_TRUE(other.m_CalledUpdate);
+	}
+	EXPECT_FALSE(bt.step());
+}
+
+TEST_F(CompositeTest, NestedWithoutObservers) {
+	MockBehavior bhMockTrue;
+	MockBehavior bhMockTrue2;
+	MockBehavior bhMockFallback;
+
+	sequence->add(&bhMockTrue);
+	sequence->add(&bhMockTrue2);
+	selector->add(sequence);
+	selector->add(&bhMockFallback);
+
+	bt.insert(*selector);
+	bt.tick();
+
+	// Children are bound to their parent, not to an observer
+	EXPECT_EQ(sequence, bhMockTrue.m_pParent);
+	EXPECT_TRUE(bhMockTrue.m_Observer.empty());
+	EXPECT_EQ(selector, sequence->m_pParent);
+
+	EXPECT_EQ(BH_SUCCESS, bhMockTrue2.m_eStatus);
+	EXPECT_EQ(BH_SUCCESS, sequence->m_eStatus);
+	EXPECT_EQ(BH_SUCCESS, selector->m_eStatus);
+	EXPECT_FALSE(bhMockFallback.m_CalledUpdate);
+}
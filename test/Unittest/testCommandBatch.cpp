@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include "../../../api/Vector2.h"
+#include "../../../api/Commands.h"
+#include "../../CommandBatch.hpp"
+#include "../../LocalCommandServer.hpp"
+
+TEST(CommandBatchTest, RoundTrip) {
+	CommandBatch batch;
+	batch.attack(3, Vector2(12.5f, 40.25f), Vector2(1.0f, -2.0f), "attack");
+	batch.charge(70, Vector2(0.0f, 87.75f), "charge");
+	EXPECT_EQ(2u, batch.size());
+	// Header, id, target and look at, then header, id and target
+	EXPECT_EQ(11u + 7u, batch.getByteSize());
+
+	CommandBatch::Reader reader(batch);
+	BatchedCommand command;
+	ASSERT_TRUE(reader.next(command));
+	EXPECT_EQ(CommandBatch::KIND_ATTACK, command.m_Kind);
+	EXPECT_EQ(3u, command.m_BotId);
+	EXPECT_EQ(Vector2(12.5f, 40.25f), command.m_Target);
+	ASSERT_TRUE(command.m_LookAt);
+	EXPECT_EQ(Vector2(1.0f, -2.0f), *command.m_LookAt);
+	EXPECT_TRUE(command.m_Description.empty());
+
+	ASSERT_TRUE(reader.next(command));
+	EXPECT_EQ(CommandBatch::KIND_CHARGE, command.m_Kind);
+	EXPECT_EQ(70u, command.m_BotId);
+	EXPECT_EQ(Vector2(0.0f, 87.75f), command.m_Target);
+	EXPECT_FALSE(command.m_LookAt);
+
+	EXPECT_FALSE(reader.next(command));
+}
+
+TEST(CommandBatchTest, Quantization) {
+	CommandBatch batch;
+	Vector2 target(10.0f / 3.0f, -7.0f / 3.0f);
+	batch.charge(0, target, "");
+	batch.charge(0, Vector2(1e6f, -1e6f), "");
+
+	CommandBatch::Reader reader(batch);
+	BatchedCommand command;
+	ASSERT_TRUE(reader.next(command));
+	EXPECT_EQ(CommandBatch::quantize(target), command.m_Target);
+	EXPECT_NEAR(target.x, command.m_Target.x, 0.5f / CommandBatch::POSITION_SCALE);
+	EXPECT_NEAR(target.y, command.m_Target.y, 0.5f / CommandBatch::POSITION_SCALE);
+
+	// Out of range positions are clamped
+	ASSERT_TRUE(reader.next(command));
+	EXPECT_EQ(CommandBatch::quantize(Vector2(1e6f, -1e6f)), command.m_Target);
+	EXPECT_GT(command.m_Target.x, 500.0f);
+	EXPECT_LT(command.m_Target.y, -500.0f);
+}
+
+TEST(CommandBatchTest, Descriptions) {
+	CommandBatch batch;
+	EXPECT_FALSE(batch.hasDescriptions());
+	batch.charge(1, Vector2(1.0f, 1.0f), "hidden");
+	size_t withoutDescription = batch.getByteSize();
+
+	batch.clear();
+	batch.setDescriptions(true);
+	batch.charge(1, Vector2(1.0f, 1.0f), "shown");
+	EXPECT_EQ(withoutDescription + 1 + 5, batch.getByteSize());
+
+	CommandBatch::Reader reader(batch);
+	BatchedCommand command;
+	ASSERT_TRUE(reader.next(command));
+	EXPECT_EQ("shown", command.m_Description);
+}
+
+TEST(CommandBatchTest, AddApiCommands) {
+	CommandBatch batch;
+	AttackCommand attack("Blue0", Vector2(2.0f, 3.0f), boost::none, "random");
+	ChargeCommand charge("Blue1", Vector2(4.0f, 5.0f), "random");
+	DefendCommand defend("Blue2");
+
+	EXPECT_TRUE(batch.add(0, attack));
+	EXPECT_TRUE(batch.add(1, charge));
+	EXPECT_FALSE(batch.add(2, defend));
+	EXPECT_EQ(2u, batch.size());
+}
+
+TEST(LocalCommandServerTest, KeepsLastOrderPerBot) {
+	LocalCommandServer server;
+	CommandBatch batch;
+
+	batch.attack(2, Vector2(1.0f, 1.0f), boost::none, "");
+	batch.charge(0, Vector2(2.0f, 2.0f), "");
+	server.flush(batch);
+
+	batch.clear();
+	batch.charge(2, Vector2(3.0f, 3.0f), "");
+	server.flush(batch);
+
+	EXPECT_EQ(2u, server.getFlushCount());
+	EXPECT_EQ(3u, server.getCommandCount());
+	EXPECT_EQ(2u, server.getDecodeLatency().getCount());
+	EXPECT_TRUE(server.getOrder(1) == NULL);
+	EXPECT_TRUE(server.getOrder(5) == NULL);
+
+	const BatchedCommand* order = server.getOrder(2);
+	ASSERT_TRUE(order != NULL);
+	EXPECT_EQ(CommandBatch::KIND_CHARGE, order->m_Kind);
+	EXPECT_EQ(Vector2(3.0f, 3.0f), order->m_Target);
+	ASSERT_TRUE(server.getOrder(0) != NULL);
+	EXPECT_EQ(CommandBatch::KIND_CHARGE, server.getOrder(0)->m_Kind);
+}
+
+TEST(LocalCommandServerTest, FirstOrderOfOneBot) {
+	LocalCommandServer server;
+	CommandBatch batch;
+
+	batch.attack(3, Vector2(4.0f, 4.0f), boost::none, "");
+	server.flush(batch);
+
+	const BatchedCommand* order = server.getOrder(3);
+	ASSERT_TRUE(order != NULL);
+	EXPECT_EQ(CommandBatch::KIND_ATTACK, order->m_Kind);
+	EXPECT_EQ(Vector2(4.0f, 4.0f), order->m_Target);
+	EXPECT_TRUE(server.getOrder(0) == NULL);
+}
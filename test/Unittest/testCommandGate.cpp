@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include "../../../api/Vector2.h"
+#include "../../../api/Commands.h"
+#include "../../../api/GameInfo.h"
+#include "../../CommandPool.hpp"
+#include "../../CommandGate.hpp"
+
+/** Test fixture with the commands of two bots */
+class CommandGateTest : public testing::Test
+{
+protected:
+	CommandPool m_pool;
+	CommandGate m_gate;
+	vector<BotId> m_bots;
+	vector<const Command*> m_commands;
+
+	virtual void SetUp() {
+		m_pool.reserve(2);
+		m_gate.reset(2);
+	}
+
+	size_t attack(float time, BotId bot, const Vector2& target)
+	{
+		m_bots.assign(1, bot);
+		m_commands.assign(1, m_pool.attack(bot, "Blue" + to_string(bot), target, boost::none, ""));
+		return m_gate.filter(time, m_bots, m_commands);
+	}
+};
+
+TEST_F(CommandGateTest, DropsSameOrder) {
+	EXPECT_EQ(0u, attack(0.0f, 0, Vector2(10.0f, 10.0f)));
+	ASSERT_EQ(1u, m_gate.getCommands().size());
+	EXPECT_EQ(0u, m_gate.getBots()[0]);
+
+	// Within the tolerance it is the same order
+	EXPECT_EQ(1u, attack(2.0f, 0, Vector2(10.2f, 10.0f)));
+	EXPECT_TRUE(m_gate.getCommands().empty());
+
+	// Another target or kind is a new order
+	EXPECT_EQ(0u, attack(4.0f, 0, Vector2(20.0f, 10.0f)));
+	m_bots.assign(1, 0);
+	m_commands.assign(1, m_pool.charge(0, "Blue0", Vector2(20.0f, 10.0f), ""));
+	EXPECT_EQ(0u, m_gate.filter(6.0f, m_bots, m_commands));
+	EXPECT_EQ(1u, m_gate.getSuppressedCount());
+
+	// Forgotten bots get their order again, e.g. after a respawn
+	m_gate.forget(0);
+	EXPECT_EQ(0u, m_gate.filter(8.0f, m_bots, m_commands));
+}
+
+TEST_F(CommandGateTest, MinInterval) {
+	m_gate.setMinInterval(1.0f);
+	EXPECT_EQ(0u, attack(0.0f, 0, Vector2(10.0f, 10.0f)));
+	EXPECT_EQ(1u, attack(0.5f, 0, Vector2(30.0f, 10.0f)));
+	EXPECT_EQ(0u, attack(1.0f, 0, Vector2(30.0f, 10.0f)));
+
+	// Bots are limited independently, the kept commands stay in bot order
+	m_bots.clear();
+	m_commands.clear();
+	m_bots.push_back(0);
+	m_commands.push_back(m_pool.attack(0, "Blue0", Vector2(5.0f, 5.0f), boost::none, ""));
+	m_bots.push_back(1);
+	m_commands.push_back(m_pool.attack(1, "Blue1", Vector2(5.0f, 5.0f), boost::none, ""));
+	EXPECT_EQ(1u, m_gate.filter(1.5f, m_bots, m_commands));
+	ASSERT_EQ(1u, m_gate.getCommands().size());
+	EXPECT_EQ(1u, m_gate.getBots()[0]);
+	EXPECT_EQ("Blue1", m_gate.getCommands()[0]->botId);
+	EXPECT_EQ(2u, m_gate.getSuppressedCount());
+}
+
+TEST_F(CommandGateTest, IdleBotsGetTheirOrderAgain) {
+	GameInfo game;
+	LevelInfo level;
+	game.match.reset(new MatchInfo());
+	game.match->timePassed = 0.0f;
+	TeamInfo blue, red;
+	FlagInfo blueFlag, redFlag;
+	blue.flag = &blueFlag;
+	red.flag = &redFlag;
+	blueFlag.carrier = redFlag.carrier = NULL;
+	game.team = &blue;
+	game.enemyTeam = &red;
+	BotInfo* bot = new BotInfo();
+	bot->name = "Blue0";
+	bot->team = &blue;
+	bot->health = 100.0f;
+	game.bots["Blue0"].reset(bot);
+	game.bots_alive.push_back(bot);
+	BotRegistry registry;
+	registry.init(game);
+	WorldSnapshot world;
+
+	// Busy with its order, the same one is dropped
+	EXPECT_EQ(0u, attack(0.0f, 0, Vector2(10.0f, 10.0f)));
+	world.build(game, level, registry);
+	m_gate.update(world);
+	EXPECT_EQ(1u, attack(1.0f, 0, Vector2(10.0f, 10.0f)));
+
+	// Done with it, the bot would stay idle without the same order again
+	game.bots_available.push_back(bot);
+	world.build(game, level, registry);
+	m_gate.update(world);
+	EXPECT_EQ(0u, attack(1.2f, 0, Vector2(10.0f, 10.0f)));
+
+	// Done with it right after it got it, the bot waits for the minimum interval
+	game.bots_available.clear();
+	world.build(game, level, registry);
+	m_gate.update(world);
+	EXPECT_EQ(0u, attack(1.8f, 0, Vector2(20.0f, 10.0f)));
+	game.bots_available.push_back(bot);
+	world.build(game, level, registry);
+	m_gate.update(world);
+	EXPECT_EQ(1u, attack(2.0f, 0, Vector2(30.0f, 10.0f)));
+	EXPECT_EQ(0u, attack(2.4f, 0, Vector2(30.0f, 10.0f)));
+
+	// Dead bots lose their order as well
+	game.bots_available.clear();
+	game.bots_alive.clear();
+	bot->health = 0.0f;
+	world.build(game, level, registry);
+	m_gate.update(world);
+	EXPECT_EQ(0u, attack(3.2f, 0, Vector2(30.0f, 10.0f)));
+}
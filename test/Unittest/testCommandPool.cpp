@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include "../../../api/Vector2.h"
+#include "../../../api/Commands.h"
+#include "../../CommandPool.hpp"
+
+TEST(CommandPoolTest, ReusesSlot) {
+	CommandPool pool;
+	pool.reserve(2);
+	EXPECT_EQ(2u, pool.size());
+
+	const Command* first = pool.attack(0, "Blue0", Vector2(1.0f, 2.0f), boost::none, "first");
+	const Command* second = pool.attack(0, "Blue0", Vector2(3.0f, 4.0f), boost::none, "second");
+
+	// Same object, new content
+	EXPECT_EQ(first, second);
+	const AttackCommand* attack = dynamic_cast<const AttackCommand*>(second);
+	ASSERT_TRUE(attack != nullptr);
+	EXPECT_EQ("second", attack->description);
+	EXPECT_EQ(Vector2(3.0f, 4.0f), attack->target.front());
+
+	// Other slots and kinds do not interfere
+	const Command* other = pool.attack(1, "Blue1", Vector2(5.0f, 6.0f), boost::none, "other");
+	const Command* charge = pool.charge(0, "Blue0", Vector2(7.0f, 8.0f), "charge");
+	EXPECT_NE(first, other);
+	EXPECT_NE(first, charge);
+	EXPECT_EQ("Blue1", other->botId);
+	EXPECT_EQ("second", attack->description);
+}
+
+TEST(CommandPoolTest, Clone) {
+	CommandPool pool;
+	pool.reserve(1);
+
+	const Command* charge = pool.charge(0, "Blue0", Vector2(7.0f, 8.0f), "charge");
+	unique_ptr<Command> copy(CommandPool::clone(*charge));
+
+	ASSERT_TRUE(dynamic_cast<ChargeCommand*>(copy.get()) != nullptr);
+	EXPECT_NE(charge, copy.get());
+	EXPECT_EQ("Blue0", copy->botId);
+	EXPECT_EQ("charge", copy->description);
+}
+
+TEST(CommandPoolTest, Release) {
+	CommandPool pool;
+	pool.reserve(1);
+
+	const Command* attack = pool.attack(0, "Blue0", Vector2(1.0f, 2.0f), boost::none, "attack");
+	const Command* charge = pool.charge(0, "Blue0", Vector2(7.0f, 8.0f), "charge");
+	unique_ptr<Command> released(pool.release(0, *attack));
+	EXPECT_EQ(attack, released.get());
+
+	// The slot emits into a new command, the released one and the other kind stay as they are
+	const Command* next = pool.attack(0, "Blue0", Vector2(3.0f, 4.0f), boost::none, "next");
+	EXPECT_NE(released.get(), next);
+	EXPECT_EQ("attack", released->description);
+	EXPECT_EQ(charge, pool.charge(0, "Blue0", Vector2(7.0f, 8.0f), "charge"));
+}
@@ -4,6 +4,7 @@
 #include "../../../api/Vector2.h"
 #include "../../../api/Commands.h"
 #include "../../DecisionMaking.h"
+#include "../../WorldSnapshot.hpp"
 
 using namespace dms;
 
@@ -14,7 +15,7 @@ public:
 
 	int calledTick;
 
-	virtual const Command* tick()
+	virtual const Command* tick(const WorldSnapshot& world)
 	{
 		calledTick++;
 		return nullptr;
@@ -64,7 +65,7 @@ public:
 
 	bool m_Condition;
 
-	virtual bool checkCondition() { return m_Condition; }
+	virtual bool checkCondition(const WorldSnapshot& world) { return m_Condition; }
 };
 
 class MockMonitor: public Monitor
@@ -72,10 +73,10 @@ class MockMonitor: public Monitor
 public:
 	MockMonitor(ActivationCondition& ac, ProfileManager& manager): Monitor(ac, manager), m_CalledUpdate(0) {}
 
-	virtual void update()
+	virtual void update(const WorldSnapshot& world)
 	{
 		m_CalledUpdate++;
-		Monitor::update();
+		Monitor::update(world);
 	}
 
 	int m_CalledUpdate;
@@ -85,7 +86,8 @@ TEST(PolymorphTest, Tick)
 {
 	DecisionMaking* mock;
 	mock = new MockDecisionMaking();
-	mock->tick();
+	WorldSnapshot world;
+	mock->tick(world);
 
 	EXPECT_EQ(1, ((MockDecisionMaking*)mock)->calledTick);
 	delete mock;
@@ -144,23 +146,23 @@ TEST_F(DecisionMakingTest, ProfileManagerAlert) {
 	
 	m_managerMock->addProfile(*currentProfile);
 
-	ProfileConnection* connection = currentProfile->getCurrentConnection();
-	EXPECT_FALSE(connection->getWeight() == 10);
+	EXPECT_FALSE(currentProfile->getWeight(0) == 10);
 
 	// Make sure the weight is correctly updated after an alert
 	m_managerMock->alert();
-	EXPECT_TRUE(connection->getWeight() == 10);
+	EXPECT_TRUE(currentProfile->getWeight(0) == 10);
 
 }
 
 TEST_F(DecisionMakingTest, MonitorUpdate) {
+	WorldSnapshot world;
 	m_mockAC->m_Condition = false;
-	m_monitorMock->update();
+	m_monitorMock->update(world);
 
 	EXPECT_EQ(0, m_managerMock->m_CalledAlert);
 
 	m_mockAC->m_Condition = true;
-	m_monitorMock->update();
+	m_monitorMock->update(world);
 
 	EXPECT_EQ(1, m_managerMock->m_CalledAlert);
 }
@@ -173,10 +175,140 @@ TEST_F(DecisionMakingTest, CDMS_init)
 }
 
 TEST_F(DecisionMakingTest, CDMS_tick){
-	m_cdms->tick();
+	WorldSnapshot world;
+	m_cdms->tick(world);
 	
 	EXPECT_EQ(1, m_managerMock->m_CalledInit);
 	EXPECT_EQ(1, m_managerMock->m_CalledTick);
 	EXPECT_EQ(1, m_monitorMock->m_CalledUpdate);
 	EXPECT_EQ(1, m_decisionMakingMock->calledTick);
-}
\ No newline at end of file
+}
+
+TEST(FeatureVectorTest, InternedValues)
+{
+	FeatureSchema& schema = FeatureSchema::getDefault();
+	FeatureId id = schema.intern("featureVectorTest");
+	EXPECT_EQ(id, schema.intern("featureVectorTest"));
+	EXPECT_EQ("featureVectorTest", schema.getName(id));
+	EXPECT_EQ((FeatureId)FeatureSchema::NO_FEATURE, schema.getId("neverInterned"));
+
+	FeatureVector features;
+	EXPECT_FLOAT_EQ(0.0f, features.get(id));
+	features.set("featureVectorTest", 2.5f);
+	EXPECT_FLOAT_EQ(2.5f, features.get(id));
+	EXPECT_EQ(1u, features.count());
+	// Padded to whole blocks of four values
+	EXPECT_EQ(0u, features.size() % 4);
+	EXPECT_GT(features.size(), (size_t)id);
+}
+
+TEST(WeightMatrixTest, WithoutDecisionMakers)
+{
+	WeightMatrix weights((vector<DecisionMaking*>()));
+	Profile profile;
+	profile.init(weights);
+	EXPECT_EQ(1u, weights.getRowCount());
+	EXPECT_EQ(0u, weights.getColumnCount());
+	profile.selectBestDecisionMaker();
+	EXPECT_EQ(NULL, profile.getCurrentDecisionMaker());
+
+	Profile own;
+	own.init(vector<DecisionMaking*>());
+	EXPECT_EQ(0u, own.getDecisionMakerCount());
+}
+
+TEST(WeightMatrixTest, SelectsBestDecisionMaker)
+{
+	MockDecisionMaking decisionMakers[5];
+	vector<DecisionMaking*> dms;
+	for (int i = 0; i < 5; i++)
+	{
+		dms.push_back(&decisionMakers[i]);
+	}
+
+	WeightMatrix weights(dms);
+	Profile first;
+	Profile second;
+	first.init(weights);
+	second.init(weights);
+	EXPECT_EQ(2u, weights.getRowCount());
+	EXPECT_EQ(1000, first.getWeight(0));
+	EXPECT_EQ(996, first.getWeight(4));
+	EXPECT_EQ(&decisionMakers[0], first.getCurrentDecisionMaker());
+
+	// The last column lies past the first block of four
+	first.setWeight(4, 2000);
+	first.selectBestDecisionMaker();
+	EXPECT_EQ(4u, first.getCurrentIndex());
+	EXPECT_EQ(&decisionMakers[4], first.getCurrentDecisionMaker());
+
+	// Rows are independent, the first of equal weights wins
+	second.setWeight(2, 1000);
+	second.selectBestDecisionMaker();
+	EXPECT_EQ(0u, second.getCurrentIndex());
+	second.setWeight(0, -5);
+	second.selectBestDecisionMaker();
+	EXPECT_EQ(2u, second.getCurrentIndex());
+	EXPECT_EQ(2000, first.getCurrentWeight());
+}
+
+TEST(WeightUpdateTest, BanditMovesTowardsReward)
+{
+	BanditUpdateRule rule(0.5f);
+	EXPECT_EQ(1500, rule.update(1000, 1.0f));
+	EXPECT_EQ(500, rule.update(1000, -1.0f));
+	EXPECT_EQ(1000, rule.update(1000, 0.0f));
+}
+
+TEST(WeightUpdateTest, EngineBatchesRewards)
+{
+	MockDecisionMaking first;
+	MockDecisionMaking second;
+	vector<DecisionMaking*> dms;
+	dms.push_back(&first);
+	dms.push_back(&second);
+	WeightMatrix weights(dms);
+	weights.addRow();
+	weights.addRow();
+
+	BanditUpdateRule rule(0.5f);
+	WeightUpdateEngine engine(&rule, 0.5f);
+	engine.addReward(1, 0, -1.0f);
+	engine.addReward(0, 1, 1.0f);
+	engine.addReward(1, 0, 1.0f);
+	EXPECT_EQ(3u, engine.getPendingCount());
+	EXPECT_EQ(1000, weights.get(1, 0));
+
+	// Both rewards of a connection are combined, the later one counting twice as much
+	EXPECT_EQ(2u, engine.apply(weights));
+	EXPECT_EQ(0u, engine.getPendingCount());
+	EXPECT_EQ(1167, weights.get(1, 0));
+	EXPECT_EQ(1500, weights.get(0, 1));
+	EXPECT_EQ(1000, weights.get(0, 0));
+
+	// Without a rule rewards are dropped
+	engine.setRule(NULL);
+	engine.addReward(0, 0, 1.0f);
+	EXPECT_EQ(0u, engine.getPendingCount());
+}
+
+TEST_F(DecisionMakingTest, AlertRewardIsBatched)
+{
+	MockDecisionMaking other;
+	m_dms.push_back(&other);
+	MockProfileManager manager(m_dms);
+	BanditUpdateRule rule(0.5f);
+	manager.setWeightUpdateRule(&rule);
+	manager.init();
+	Profile* profile = manager.getCurrentProfile();
+	manager.addProfile(*profile);
+
+	manager.alert();
+	EXPECT_EQ(1000, profile->getWeight(0));
+	EXPECT_EQ(1u, manager.getPendingRewardCount());
+
+	// The bad performance moves the profile over to the other DMS
+	manager.applyRewards();
+	EXPECT_EQ(500, profile->getWeight(0));
+	EXPECT_EQ(&other, manager.getCurrentProfile()->getCurrentDecisionMaker());
+}
@@ -0,0 +1,98 @@
+#include "../../tools/Delegate.h"
+#include "gtest/gtest.h"
+
+static int s_FreeCalls = 0;
+
+static void freeFunction()
+{
+	s_FreeCalls++;
+}
+
+static int twice(int value)
+{
+	return value * 2;
+}
+
+class Counter
+{
+public:
+	Counter(): m_Count(0) {}
+
+	void increment() { m_Count++; }
+	int add(int value) { m_Count += value; return m_Count; }
+	int get() const { return m_Count; }
+
+	int m_Count;
+};
+
+TEST(DelegateTest, Empty) {
+	Delegate<void ()> delegate;
+	EXPECT_TRUE(delegate.empty());
+
+	delegate.bind(&freeFunction);
+	EXPECT_FALSE(delegate.empty());
+
+	delegate.clear();
+	EXPECT_TRUE(delegate.empty());
+}
+
+TEST(DelegateTest, FreeFunction) {
+	s_FreeCalls = 0;
+	Delegate<void ()> delegate(&freeFunction);
+	delegate();
+	EXPECT_EQ(1, s_FreeCalls);
+
+	Delegate<int (int)> withParam(&twice);
+	EXPECT_EQ(42, withParam(21));
+}
+
+TEST(DelegateTest, Method) {
+	Counter counter;
+	Delegate<void ()> delegate(&counter, &Counter::increment);
+	delegate();
+	delegate();
+	EXPECT_EQ(2, counter.m_Count);
+
+	Delegate<int (int)> add;
+	add.bind(&counter, &Counter::add);
+	EXPECT_EQ(7, add(5));
+
+	Delegate<int ()> get;
+	get.bind(&counter, &Counter::get);
+	EXPECT_EQ(7, get());
+}
+
+TEST(DelegateTest, Functor) {
+	int calls = 0;
+	int* pCalls = &calls;
+	Delegate<void ()> delegate = Delegate<void ()>::fromFunctor([pCalls]() { (*pCalls)++; });
+	delegate();
+
+	Delegate<int (int)> offset;
+	int base = 10;
+	offset.bind([base](int value) { return base + value; });
+
+	EXPECT_EQ(1, calls);
+	EXPECT_EQ(15, offset(5));
+}
+
+TEST(DelegateTest, CopyAndCompare) {
+	Counter counter;
+	Delegate<void ()> delegate(&counter, &Counter::increment);
+	Delegate<void ()> copy(delegate);
+	Delegate<void ()> assigned;
+	assigned = copy;
+
+	delegate();
+	copy();
+	assigned();
+
+	EXPECT_EQ(3, counter.m_Count);
+	EXPECT_TRUE(copy == delegate);
+	EXPECT_TRUE(assigned == delegate);
+
+	Counter other;
+	Delegate<void ()> otherDelegate(&other, &Counter::increment);
+	EXPECT_TRUE(otherDelegate != delegate);
+	EXPECT_TRUE(Delegate<void ()>() == Delegate<void ()>());
+}
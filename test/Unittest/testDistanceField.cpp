@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include "../../../api/GameInfo.h"
+#include "../../DistanceField.hpp"
+
+/** Test fixture with a level split by a wall with one gap */
+class DistanceFieldTest : public testing::Test
+{
+protected:
+	LevelInfo m_level;
+	SpatialGrid m_grid;
+
+	virtual void SetUp() {
+		m_level.width = 10;
+		m_level.height = 6;
+		m_level.blockHeights.assign(m_level.width, vector<float>(m_level.height, 0.0f));
+		for (int y = 0; y < m_level.height; y++)
+		{
+			m_level.blockHeights[5][y] = 1.0f;
+		}
+		m_level.blockHeights[5][0] = 0.0f;
+		m_grid.build(m_level);
+	}
+};
+
+TEST_F(DistanceFieldTest, WalksAroundBlocks) {
+	DistanceField field;
+	field.build(m_grid, vector<Vector2>(1, Vector2(8.5f, 5.5f)));
+
+	EXPECT_EQ(0u, field.getDistance(Vector2(8.5f, 5.5f)));
+	EXPECT_EQ(2u, field.getDistance(Vector2(6.5f, 3.5f)));
+	// Through the gap at the top of the wall
+	EXPECT_EQ(12u, field.getDistance(Vector2(4.5f, 5.5f)));
+	EXPECT_FALSE(field.isReachable(Vector2(5.5f, 3.5f)));
+
+	// Following the next steps leads to the source in as many steps
+	Vector2 position(4.5f, 5.5f);
+	for (unsigned steps = field.getDistance(position); steps > 0; steps--)
+	{
+		Vector2 next;
+		ASSERT_TRUE(field.getNextStep(position, next));
+		ASSERT_EQ(steps - 1, field.getDistance(next));
+		ASSERT_TRUE(m_grid.isFree((int)next.x, (int)next.y));
+		position = next;
+	}
+	EXPECT_EQ(Vector2(8.5f, 5.5f), position);
+}
+
+TEST_F(DistanceFieldTest, NearestOfManySources) {
+	vector<Vector2> sources;
+	sources.push_back(Vector2(0.5f, 5.5f));
+	sources.push_back(Vector2(9.5f, 5.5f));
+	DistanceField field;
+	field.build(m_grid, sources);
+
+	EXPECT_EQ(1u, field.getDistance(Vector2(1.5f, 4.5f)));
+	EXPECT_EQ(1u, field.getDistance(Vector2(8.5f, 4.5f)));
+	EXPECT_EQ(5u, field.getDistance(Vector2(4.5f, 0.5f)));
+}
+
+TEST_F(DistanceFieldTest, CacheSearchesMovedTargetsOnly) {
+	GameInfo game;
+	game.match.reset(new MatchInfo());
+	game.match->timePassed = 0.0f;
+	TeamInfo blue, red;
+	FlagInfo blueFlag, redFlag;
+	blue.name = "Blue";
+	red.name = "Red";
+	blue.flag = &blueFlag;
+	red.flag = &redFlag;
+	blueFlag.carrier = redFlag.carrier = NULL;
+	blueFlag.position = blue.flagScoreLocation = Vector2(1.5f, 1.5f);
+	redFlag.position = red.flagScoreLocation = Vector2(8.5f, 1.5f);
+	game.team = &blue;
+	game.enemyTeam = &red;
+	BotRegistry registry;
+	registry.init(game);
+
+	WorldSnapshot world;
+	DistanceFieldCache cache;
+	cache.init(m_grid);
+	world.build(game, m_level, registry);
+	cache.update(world);
+	// Nothing is searched before it is read
+	EXPECT_EQ(0u, cache.getBuildCount());
+	EXPECT_EQ(0u, cache.get(DistanceFieldCache::ENEMY_FLAG).getDistance(Vector2(8.5f, 1.5f)));
+	EXPECT_EQ(0u, cache.get(DistanceFieldCache::ENEMY_FLAG).getDistance(Vector2(8.5f, 1.5f)));
+	EXPECT_EQ(1u, cache.getBuildCount());
+
+	// Moving within the cell keeps the field
+	redFlag.position = Vector2(8.9f, 1.1f);
+	world.build(game, m_level, registry);
+	cache.update(world);
+	cache.get(DistanceFieldCache::ENEMY_FLAG);
+	EXPECT_EQ(1u, cache.getBuildCount());
+
+	redFlag.position = Vector2(6.5f, 1.5f);
+	world.build(game, m_level, registry);
+	cache.update(world);
+	EXPECT_EQ(0u, cache.get(DistanceFieldCache::ENEMY_FLAG).getDistance(Vector2(6.5f, 1.5f)));
+	EXPECT_EQ(2u, cache.get(DistanceFieldCache::ENEMY_SCORE_LOCATION).getDistance(Vector2(6.5f, 1.5f)));
+	EXPECT_EQ(3u, cache.getBuildCount());
+}
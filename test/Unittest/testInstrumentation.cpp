@@ -0,0 +1,83 @@
+#include <sstream>
+#include "../../tools/Instrumentation.h"
+#include "gtest/gtest.h"
+
+TEST(LatencyHistogramTest, Percentiles) {
+	LatencyHistogram histogram;
+	EXPECT_EQ(0u, histogram.getPercentile(0.5));
+
+	for (boost::uint64_t i = 1; i <= 1000; i++)
+	{
+		histogram.record(i * 1000);
+	}
+
+	EXPECT_EQ(1000u, histogram.getCount());
+	EXPECT_EQ(1000000u, histogram.getMax());
+	EXPECT_EQ(500500u, histogram.getMean());
+
+	// Within the bucket precision of 12.5%
+	EXPECT_NEAR(500000.0, (double)histogram.getPercentile(0.5), 500000.0 * 0.125);
+	EXPECT_NEAR(990000.0, (double)histogram.getPercentile(0.99), 990000.0 * 0.125);
+	EXPECT_EQ(1000000u, histogram.getPercentile(1.0));
+}
+
+TEST(LatencyHistogramTest, SmallValuesAreExact) {
+	LatencyHistogram histogram;
+	histogram.record(3);
+	histogram.record(3);
+	histogram.record(7);
+
+	EXPECT_EQ(3u, histogram.getPercentile(0.5));
+	EXPECT_EQ(7u, histogram.getPercentile(0.99));
+}
+
+TEST(LatencyHistogramTest, Merge) {
+	LatencyHistogram a;
+	LatencyHistogram b;
+	a.record(100);
+	b.record(200);
+	b.record(300);
+	a.merge(b);
+
+	EXPECT_EQ(3u, a.getCount());
+	EXPECT_EQ(300u, a.getMax());
+}
+
+TEST(InstrumentationTest, DisabledByDefault) {
+	Instrumentation instrumentation;
+	instrumentation.setBotName(0, "Blue0");
+
+	EXPECT_FALSE(instrumentation.isEnabled());
+	EXPECT_TRUE(instrumentation.timer(Instrumentation::STAGE_COMMANDER) == NULL);
+	EXPECT_TRUE(instrumentation.botTimer(0) == NULL);
+
+	instrumentation.count(Instrumentation::COUNTER_TICKS);
+	EXPECT_EQ(0u, instrumentation.getCounter(Instrumentation::COUNTER_TICKS));
+}
+
+TEST(InstrumentationTest, TimersAndDump) {
+	Instrumentation instrumentation;
+	instrumentation.setBotName(0, "Blue0");
+	instrumentation.setEnabled(true);
+
+	{
+		ScopedTimer timer(instrumentation.timer(Instrumentation::STAGE_PLANER));
+		ScopedTimer botTimer(instrumentation.botTimer(0));
+	}
+	instrumentation.count(Instrumentation::COUNTER_COMMANDS, 3);
+
+	EXPECT_EQ(1u, instrumentation.getStage(Instrumentation::STAGE_PLANER).getCount());
+	EXPECT_EQ(1u, instrumentation.getBot(0).getCount());
+	EXPECT_EQ(3u, instrumentation.getCounter(Instrumentation::COUNTER_COMMANDS));
+
+	stringstream out;
+	instrumentation.dump(out);
+	EXPECT_NE(string::npos, out.str().find("planer"));
+	EXPECT_NE(string::npos, out.str().find("Blue0"));
+	EXPECT_NE(string::npos, out.str().find("suppressed"));
+
+	// The caller's format is kept
+	out.str("");
+	out << 2.25;
+	EXPECT_EQ("2.25", out.str());
+}
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include "../../../api/GameInfo.h"
+#include "../../../api/Commander.h"
+#include "../../CommandBatch.hpp"
+#include "../../BotRegistry.hpp"
+#include "../../sim/MatchSimulator.hpp"
+
+/**
+* Sends every available bot to the enemy flag and counts what it sees.
+*/
+class ChargeCommander : public Commander
+{
+public:
+	ChargeCommander(CommandSink& sink) : m_Sink(&sink), m_Initialized(0), m_Ticks(0), m_ShutDown(0) {}
+
+	virtual string getName() const { return "ChargeCommander"; }
+
+	virtual void initialize()
+	{
+		m_Initialized++;
+		m_Registry.init(*m_game);
+	}
+
+	virtual void tick()
+	{
+		m_Ticks++;
+		m_Batch.clear();
+		for (auto i = m_game->bots_available.begin(); i != m_game->bots_available.end(); ++i)
+		{
+			m_Batch.charge(m_Registry.getId(**i), m_game->enemyTeam->flag->position, "");
+		}
+		m_Sink->flush(m_Batch);
+	}
+
+	virtual void shutdown() { m_ShutDown++; }
+
+	CommandSink* m_Sink;
+	BotRegistry m_Registry;
+	CommandBatch m_Batch;
+	int m_Initialized;
+	int m_Ticks;
+	int m_ShutDown;
+};
+
+static MatchConfig shortMatch(boost::uint64_t seed)
+{
+	MatchConfig config;
+	config.m_Seed = seed;
+	config.m_BotsPerTeam = 4;
+	config.m_GameLength = 60.0f;
+	return config;
+}
+
+TEST(MatchSimulatorTest, SetUp) {
+	MatchSimulator simulator(shortMatch(1));
+	simulator.setUp();
+	GameInfo& game = simulator.getGame();
+	LevelInfo& level = simulator.getLevel();
+
+	EXPECT_EQ(8u, game.bots.size());
+	EXPECT_EQ(4u, game.team->members.size());
+	EXPECT_EQ(4u, game.bots_alive.size());
+	EXPECT_EQ(4u, game.bots_available.size());
+	EXPECT_EQ(8u, game.match->combatEvents.size());
+	EXPECT_EQ(MatchCombatEvent::TYPE_RESPAWN, game.match->combatEvents[0].type);
+
+	EXPECT_EQ(88, level.width);
+	EXPECT_EQ(88u, level.blockHeights.size());
+	for (auto i = game.bots.begin(); i != game.bots.end(); ++i)
+	{
+		const Vector2& position = *i->second->position;
+		EXPECT_EQ(0.0f, level.blockHeights[(int)position.x][(int)position.y]);
+	}
+}
+
+TEST(MatchSimulatorTest, RunsWholeMatch) {
+	MatchSimulator simulator(shortMatch(2));
+	ChargeCommander commander(simulator);
+	MatchStats stats = simulator.run(commander);
+
+	EXPECT_EQ(1, commander.m_Initialized);
+	EXPECT_EQ(1, commander.m_ShutDown);
+	EXPECT_EQ(600, commander.m_Ticks);
+	EXPECT_EQ(600u, stats.m_Ticks);
+	EXPECT_GT(stats.m_Commands, 4u);
+	EXPECT_GT(stats.m_Kills, 0u);
+	EXPECT_EQ(stats.m_Score, simulator.getGame().match->scores["Blue"]);
+	EXPECT_EQ(stats.m_EnemyScore, simulator.getGame().match->scores["Red"]);
+}
+
+TEST(MatchSimulatorTest, Deterministic) {
+	MatchSimulator first(shortMatch(3));
+	MatchSimulator second(shortMatch(3));
+	ChargeCommander firstCommander(first);
+	ChargeCommander secondCommander(second);
+	MatchStats a = first.run(firstCommander);
+	MatchStats b = second.run(secondCommander);
+
+	EXPECT_EQ(a.m_Commands, b.m_Commands);
+	EXPECT_EQ(a.m_Kills, b.m_Kills);
+	EXPECT_EQ(a.m_Captures, b.m_Captures);
+	EXPECT_EQ(first.getGame().match->combatEvents.size(), second.getGame().match->combatEvents.size());
+
+	const vector<BotInfo*>& firstBots = first.getGame().team->members;
+	const vector<BotInfo*>& secondBots = second.getGame().team->members;
+	for (size_t i = 0; i < firstBots.size(); i++)
+	{
+		EXPECT_EQ(*firstBots[i]->position, *secondBots[i]->position);
+	}
+}
@@ -0,0 +1,224 @@
+#include <cmath>
+#include <gtest/gtest.h>
+
+#include "../../../api/GameInfo.h"
+#include "../../OpponentFeatures.hpp"
+#include "../../sim/MatchSimulator.hpp"
+
+class WaitingDecisionMaking : public DecisionMaking
+{
+public:
+	virtual const Command* tick(const WorldSnapshot& world) { return nullptr; }
+};
+
+/**
+* Profile manager observing the opponent like the ones of the planer.
+*/
+class OpponentProfileManager : public ProfileManager
+{
+	const OpponentFeatureExtractor* m_Extractor;
+
+public:
+	OpponentProfileManager(const OpponentFeatureExtractor& extractor, vector<DecisionMaking*> dms)
+		: ProfileManager(dms), m_Extractor(&extractor)
+	{
+		setSimilarityThreshold(OpponentFeatureExtractor::getSimilarityThreshold());
+	}
+
+	virtual int performanceUpdate(DecisionMaking& decisionMaker, int currentWeight) { return currentWeight - 1; }
+
+	virtual void updateInternalFeatures() { m_InternalFeatures = m_Extractor->getFeatures(); }
+};
+
+/**
+* Features of the whole match history, decayed to its current time.
+*/
+static float killRateFromHistory(const GameInfo& game, float halfLife)
+{
+	const vector<MatchCombatEvent>& events = game.match->combatEvents;
+	float now = game.match->timePassed;
+	float count = 0.0f;
+	for (auto iter = events.begin(); iter != events.end(); ++iter)
+	{
+		const MatchCombatEvent& event = *iter;
+		if (event.type == MatchCombatEvent::TYPE_KILLED && event.killedEventData.subject->team == game.team)
+		{
+			count += exp2(-(now - event.time) / halfLife);
+		}
+	}
+	return count * 60.0f * log(2.0f) / halfLife;
+}
+
+static MatchConfig opponentMatch(boost::uint64_t seed)
+{
+	MatchConfig config;
+	config.m_Seed = seed;
+	config.m_BotsPerTeam = 5;
+	config.m_GameLength = 120.0f;
+	config.m_KillRate = 2.0f;
+	return config;
+}
+
+/**
+* Takes the state of the simulated match into the world and the extractor, like a tick of the planer.
+*/
+static void observe(MatchSimulator& simulator, const BotRegistry& registry, WorldSnapshot& world, OpponentFeatureExtractor& extractor)
+{
+	world.build(simulator.getGame(), simulator.getLevel(), registry);
+	extractor.update(world);
+}
+
+TEST(OpponentFeaturesTest, IncrementalMatchesHistory) {
+	MatchSimulator simulator(opponentMatch(4));
+	simulator.setUp();
+	GameInfo& game = simulator.getGame();
+	BotRegistry registry;
+	registry.init(game);
+	WorldSnapshot world;
+	OpponentFeatureExtractor extractor(20.0f);
+	FeatureId killRate = extractor.getFeatureId(OpponentFeatureExtractor::FEATURE_KILL_RATE);
+
+	size_t kills = 0;
+	while (!simulator.isOver())
+	{
+		simulator.step();
+		observe(simulator, registry, world, extractor);
+		float expected = OpponentFeatureExtractor::normalizeRate(OpponentFeatureExtractor::FEATURE_KILL_RATE, killRateFromHistory(game, extractor.getHalfLife()));
+		EXPECT_NEAR(expected, extractor.getFeatures().get(killRate), 1e-3f * (1.0f + expected));
+	}
+
+	const vector<MatchCombatEvent>& events = game.match->combatEvents;
+	for (auto iter = events.begin(); iter != events.end(); ++iter)
+	{
+		kills += iter->type == MatchCombatEvent::TYPE_KILLED && iter->killedEventData.subject->team == game.team ? 1 : 0;
+	}
+	EXPECT_GT(kills, 0u);
+
+	// Our idle bots are approached by the scripted team
+	float advance = extractor.getFeatures().get(extractor.getFeatureId(OpponentFeatureExtractor::FEATURE_ADVANCE));
+	EXPECT_GT(advance, 0.0f);
+	EXPECT_LE(advance, 1.0f);
+	float distance = extractor.getFeatures().get(extractor.getFeatureId(OpponentFeatureExtractor::FEATURE_KILL_DISTANCE));
+	EXPECT_GT(distance, 0.0f);
+	EXPECT_LE(distance, 1.0f);
+}
+
+TEST(OpponentFeaturesTest, KillDistanceWhereTheKillHappened) {
+	GameInfo game;
+	LevelInfo level;
+	game.match.reset(new MatchInfo());
+	TeamInfo blue, red;
+	FlagInfo blueFlag, redFlag;
+	blue.name = "Blue";
+	red.name = "Red";
+	blue.flag = &blueFlag;
+	red.flag = &redFlag;
+	blueFlag.carrier = redFlag.carrier = NULL;
+	blue.flagSpawnLocation = Vector2(10.0f, 0.0f);
+	red.botSpawnArea = make_pair(Vector2(0.0f, 0.0f), Vector2(0.0f, 0.0f));
+	game.team = &blue;
+	game.enemyTeam = &red;
+	BotInfo* ours = new BotInfo();
+	ours->name = "Blue0";
+	ours->team = &blue;
+	ours->position = Vector2(2.0f, 0.0f);
+	game.bots["Blue0"].reset(ours);
+	BotInfo* enemy = new BotInfo();
+	enemy->name = "Red0";
+	enemy->team = &red;
+	enemy->health = 100.0f;
+	enemy->position = Vector2(6.0f, 0.0f);
+	game.bots["Red0"].reset(enemy);
+	BotRegistry registry;
+	registry.init(game);
+	WorldSnapshot world;
+	OpponentFeatureExtractor extractor;
+	FeatureId distance = extractor.getFeatureId(OpponentFeatureExtractor::FEATURE_KILL_DISTANCE);
+
+	// Killed since the last update and still dead, measured where both are
+	MatchCombatEvent kill;
+	kill.type = MatchCombatEvent::TYPE_KILLED;
+	kill.time = 1.5f;
+	kill.killedEventData.instigator = enemy;
+	kill.killedEventData.subject = ours;
+	game.match->combatEvents.push_back(kill);
+	game.match->timePassed = 2.0f;
+	world.build(game, level, registry);
+	extractor.update(world);
+	EXPECT_FLOAT_EQ(0.4f, extractor.getFeatures().get(distance));
+
+	// Respawned by the update, our bot is not where it was killed
+	kill.time = 2.5f;
+	game.match->combatEvents.push_back(kill);
+	game.bots_alive.push_back(ours);
+	ours->position = Vector2(9.0f, 0.0f);
+	game.match->timePassed = 3.0f;
+	world.build(game, level, registry);
+	extractor.update(world);
+	EXPECT_FLOAT_EQ(0.4f, extractor.getFeatures().get(distance));
+	EXPECT_GT(extractor.getFeatures().get(extractor.getFeatureId(OpponentFeatureExtractor::FEATURE_KILL_RATE)), 0.0f);
+}
+
+TEST(OpponentFeaturesTest, ResetsForNewMatch) {
+	MatchSimulator simulator(opponentMatch(5));
+	simulator.setUp();
+	BotRegistry registry;
+	registry.init(simulator.getGame());
+	WorldSnapshot world;
+	OpponentFeatureExtractor extractor;
+	for (int i = 0; i < 300; i++)
+	{
+		simulator.step();
+		observe(simulator, registry, world, extractor);
+	}
+
+	// Setting up again starts a new match, the history of the last one is dropped
+	simulator.setUp();
+	registry.init(simulator.getGame());
+	observe(simulator, registry, world, extractor);
+	const FeatureVector& features = extractor.getFeatures();
+	for (int i = 0; i < OpponentFeatureExtractor::FEATURE_COUNT; i++)
+	{
+		EXPECT_EQ(0.0f, features.get(extractor.getFeatureId(i)));
+	}
+}
+
+TEST(OpponentFeaturesTest, AlertsFindTheStyleAgain) {
+	MatchSimulator simulator(opponentMatch(4));
+	simulator.setUp();
+	BotRegistry registry;
+	registry.init(simulator.getGame());
+	WorldSnapshot world;
+	OpponentFeatureExtractor extractor;
+	WaitingDecisionMaking first, second;
+	vector<DecisionMaking*> dms;
+	dms.push_back(&first);
+	dms.push_back(&second);
+	OpponentProfileManager manager(extractor, dms);
+
+	float alerts[] = { 60.0f, 63.0f, 66.0f };
+	Profile* created = NULL;
+	for (int i = 0; i < 3; i++)
+	{
+		while (simulator.getGame().match->timePassed < alerts[i])
+		{
+			simulator.step();
+			observe(simulator, registry, world, extractor);
+		}
+		manager.tick();
+		manager.alert();
+		if (created == NULL)
+		{
+			// Nothing was seen before, the style becomes a profile
+			created = manager.getCurrentProfile();
+			const FeatureVector& features = created->getFeatures();
+			EXPECT_GT(features.count(), 0u);
+			for (size_t feature = 0; feature < features.size(); feature++)
+			{
+				EXPECT_LE(features.data()[feature], 1.0f);
+			}
+		}
+		// The style changes a little within a few seconds, whatever the unit of its features
+		EXPECT_EQ(created, manager.getCurrentProfile());
+	}
+}
@@ -0,0 +1,218 @@
+#include <cstdio>
+#include <gtest/gtest.h>
+
+#include "../../../api/Commands.h"
+#include "../../DecisionMaking.h"
+#include "../../ProfileIndex.h"
+#include "../../ProfileStore.h"
+#include "../../tools/Random.h"
+
+using namespace dms;
+
+class IdleDecisionMaking : public DecisionMaking
+{
+public:
+	virtual const Command* tick(const WorldSnapshot& world) { return nullptr; }
+};
+
+class ObservingProfileManager : public ProfileManager
+{
+public:
+	ObservingProfileManager(vector<DecisionMaking*> dms) : ProfileManager(dms) {}
+
+	virtual int performanceUpdate(DecisionMaking& decisionMaker, int currentWeight)
+	{
+		return currentWeight + 1;
+	}
+
+	void observe(const string& name, int value)
+	{
+		m_InternalFeatures.set(name, (float)value);
+	}
+};
+
+static void randomPoints(Random& random, size_t count, size_t dimension, ProfileIndex& index)
+{
+	vector<float> point(dimension);
+	for (size_t i = 0; i < count; i++)
+	{
+		for (size_t axis = 0; axis < dimension; axis++)
+		{
+			point[axis] = random.nextFloat() * 100.0f;
+		}
+		index.add(&point[0]);
+	}
+}
+
+TEST(ProfileIndexTest, EmptyIndexFindsNothing) {
+	ProfileIndex index(3);
+	float query[] = { 1.0f, 2.0f, 3.0f };
+	EXPECT_FALSE(index.findNearest(query).found());
+
+	index.build();
+	EXPECT_FALSE(index.findNearest(query).found());
+}
+
+TEST(ProfileIndexTest, TreeMatchesBruteForce) {
+	Random random(7);
+	ProfileIndex index(5);
+	randomPoints(random, 2000, 5, index);
+	index.build();
+	EXPECT_EQ(0u, index.getUnindexedCount());
+
+	// Vectors added after the build are searched too
+	randomPoints(random, 40, 5, index);
+	EXPECT_EQ(40u, index.getUnindexedCount());
+
+	vector<float> query(5);
+	for (int i = 0; i < 200; i++)
+	{
+		for (size_t axis = 0; axis < query.size(); axis++)
+		{
+			query[axis] = random.nextFloat() * 100.0f;
+		}
+		ProfileMatch match = index.findNearest(&query[0]);
+		ProfileMatch expected = index.findNearestBruteForce(&query[0]);
+		ASSERT_TRUE(match.found());
+		EXPECT_FLOAT_EQ(expected.m_Distance, match.m_Distance);
+	}
+
+	// An indexed vector is its own nearest one
+	ProfileMatch self = index.findNearest(index.getPoint(1234));
+	EXPECT_EQ(1234u, self.m_Index);
+	EXPECT_FLOAT_EQ(0.0f, self.m_Distance);
+}
+
+TEST(ProfileIndexTest, GrowingDimensionPadsWithZeros) {
+	ProfileIndex index(3);
+	float first[] = { 3.0f, 0.0f, 4.0f };
+	index.add(first);
+	index.setDimension(6);
+	float second[] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 2.0f };
+	index.add(second);
+
+	EXPECT_EQ(6u, index.getDimension());
+	EXPECT_FLOAT_EQ(0.0f, index.getPoint(0)[5]);
+
+	float query[] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	ProfileMatch match = index.findNearest(query);
+	EXPECT_EQ(1u, match.m_Index);
+	EXPECT_FLOAT_EQ(2.0f, match.m_Distance);
+
+	query[5] = 5.0f;
+	match = index.findNearest(query);
+	EXPECT_EQ(1u, match.m_Index);
+	EXPECT_FLOAT_EQ(3.0f, match.m_Distance);
+}
+
+TEST(ProfileIndexTest, AlertSelectsSimilarLibraryProfile) {
+	const char* path = "testProfileIndex.bin";
+	remove(path);
+
+	IdleDecisionMaking first;
+	IdleDecisionMaking second;
+	vector<DecisionMaking*> dms;
+	dms.push_back(&first);
+	dms.push_back(&second);
+
+	ProfileStore store;
+	ASSERT_TRUE(store.open(path));
+	for (int i = 0; i < 100; i++)
+	{
+		Profile profile;
+		profile.init(dms);
+		profile.getFeatures().set("aggression", (float)i);
+		profile.getFeatures().set("movement", 2.0f * i);
+		profile.setWeight(1, 2000 + i);
+		store.add(profile);
+	}
+	ASSERT_TRUE(store.flush());
+
+	ObservingProfileManager manager(dms);
+	manager.setProfileLibrary(&store);
+	manager.init();
+
+	// Matches the profile stored with an aggression of 40, which is loaded then
+	manager.observe("aggression", 40);
+	manager.observe("movement", 80);
+	manager.alert();
+	Profile* current = manager.getCurrentProfile();
+	EXPECT_FLOAT_EQ(40.0f, current->getFeatures().get("aggression"));
+	EXPECT_EQ(2041, current->getCurrentWeight());
+
+	// Nothing is close enough to an unknown feature, a profile of it is created from the current one
+	manager.observe("stealth", 50);
+	manager.alert();
+	Profile* created = manager.getCurrentProfile();
+	EXPECT_NE(current, created);
+	EXPECT_FLOAT_EQ(50.0f, created->getFeatures().get("stealth"));
+	EXPECT_FLOAT_EQ(0.0f, created->getFeatures().get("aggression"));
+	EXPECT_EQ(2042, created->getCurrentWeight());
+
+	// A similar alert later on finds the created profile
+	manager.observe("stealth", 50);
+	manager.observe("movement", 0);
+	manager.alert();
+	EXPECT_EQ(created, manager.getCurrentProfile());
+	EXPECT_EQ(2043, created->getCurrentWeight());
+
+	store.close();
+	remove(path);
+	remove(ProfileStore::getLockPath(path).c_str());
+}
+
+TEST(ProfileIndexTest, ManagersShareTheLibraryIndex) {
+	const char* path = "testProfileIndex.bin";
+	remove(path);
+
+	IdleDecisionMaking first;
+	IdleDecisionMaking second;
+	vector<DecisionMaking*> firstDms(1, &first);
+	vector<DecisionMaking*> secondDms(1, &second);
+
+	ProfileStore store;
+	ASSERT_TRUE(store.open(path));
+	for (int i = 0; i < 10; i++)
+	{
+		Profile profile;
+		profile.init(firstDms);
+		profile.getFeatures().set("aggression", (float)i);
+		store.add(profile);
+	}
+	ASSERT_TRUE(store.flush());
+
+	LibraryIndex index;
+	ObservingProfileManager a(firstDms);
+	ObservingProfileManager b(secondDms);
+	a.setProfileLibrary(&store);
+	b.setProfileLibrary(&store);
+	a.setLibraryIndex(&index);
+	b.setLibraryIndex(&index);
+	a.init();
+	b.init();
+	EXPECT_EQ(10u, index.size());
+
+	// Both see the same library profile with one search, each loads it with its own weights
+	a.observe("aggression", 4);
+	b.observe("aggression", 4);
+	a.alert();
+	b.alert();
+	EXPECT_EQ(1u, index.getSearchCount());
+	EXPECT_NE(a.getCurrentProfile(), b.getCurrentProfile());
+	EXPECT_FLOAT_EQ(4.0f, b.getCurrentProfile()->getFeatures().get("aggression"));
+	EXPECT_EQ(&second, b.getCurrentProfile()->getCurrentDecisionMaker());
+
+	// An unknown style gets one entry, the second manager finds the one the first created
+	a.observe("stealth", 30);
+	b.observe("stealth", 30);
+	a.alert();
+	b.alert();
+	EXPECT_EQ(2u, index.getSearchCount());
+	EXPECT_EQ(11u, index.size());
+	EXPECT_FLOAT_EQ(30.0f, b.getCurrentProfile()->getFeatures().get("stealth"));
+	EXPECT_EQ(&second, b.getCurrentProfile()->getCurrentDecisionMaker());
+
+	store.close();
+	remove(path);
+	remove(ProfileStore::getLockPath(path).c_str());
+}
@@ -0,0 +1,312 @@
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <boost/thread/thread.hpp>
+
+#include "../../../api/Commands.h"
+#include "../../DecisionMaking.h"
+#include "../../ProfileStore.h"
+
+using namespace dms;
+
+class NullDecisionMaking : public DecisionMaking
+{
+public:
+	virtual const Command* tick(const WorldSnapshot& world) { return nullptr; }
+};
+
+class FixedProfileManager : public ProfileManager
+{
+public:
+	FixedProfileManager(vector<DecisionMaking*> dms) : ProfileManager(dms) {}
+
+	virtual int performanceUpdate(DecisionMaking& decisionMaker, int currentWeight)
+	{
+		return 5;
+	}
+};
+
+class ProfileStoreTest : public testing::Test
+{
+protected:
+	string m_Path;
+	NullDecisionMaking m_First;
+	NullDecisionMaking m_Second;
+	vector<DecisionMaking*> m_Dms;
+
+	virtual void SetUp() {
+		m_Path = "testProfileStore.bin";
+		remove(m_Path.c_str());
+		m_Dms.push_back(&m_First);
+		m_Dms.push_back(&m_Second);
+	}
+
+	virtual void TearDown() {
+		remove(m_Path.c_str());
+		remove(ProfileStore::getLockPath(m_Path).c_str());
+	}
+
+	void addProfile(ProfileStore& store, int aggression, int firstWeight, int secondWeight)
+	{
+		Profile profile;
+		profile.init(m_Dms);
+		profile.getFeatures().set("aggression", (float)aggression);
+		profile.getFeatures().set("movement", 3.0f);
+		profile.setWeight(0, firstWeight);
+		profile.setWeight(1, secondWeight);
+		store.add(profile);
+	}
+};
+
+TEST_F(ProfileStoreTest, RoundTrip) {
+	{
+		ProfileStore store;
+		ASSERT_TRUE(store.open(m_Path));
+		EXPECT_EQ(0u, store.size());
+
+		addProfile(store, 7, 100, 200);
+		addProfile(store, -2, 300, 50);
+		EXPECT_EQ(2u, store.getPendingCount());
+		EXPECT_EQ(0u, store.size());
+		ASSERT_TRUE(store.flush());
+		EXPECT_EQ(2u, store.size());
+		EXPECT_EQ(0u, store.getPendingCount());
+	}
+
+	ProfileStore store;
+	ASSERT_TRUE(store.open(m_Path));
+	ASSERT_EQ(2u, store.size());
+	EXPECT_EQ(2u, store.getSchema().size());
+	EXPECT_EQ(0, store.getSchema().getId("aggression"));
+
+	WeightMatrix weights(m_Dms);
+	Profile profile;
+	store.load(0, profile, weights);
+	ASSERT_EQ(2u, profile.getFeatures().count());
+	EXPECT_FLOAT_EQ(7.0f, profile.getFeatures().get("aggression"));
+	EXPECT_FLOAT_EQ(3.0f, profile.getFeatures().get("movement"));
+	EXPECT_EQ(200, profile.getWeight(1));
+	// The best connection is the current one
+	EXPECT_EQ(&m_Second, profile.getCurrentDecisionMaker());
+
+	Profile second;
+	store.load(1, second, weights);
+	EXPECT_FLOAT_EQ(-2.0f, second.getFeatures().get("aggression"));
+	EXPECT_EQ(&m_First, second.getCurrentDecisionMaker());
+	// Both profiles are rows of the same matrix
+	EXPECT_EQ(2u, weights.getRowCount());
+
+	// Appending keeps the names interned so far
+	Profile third;
+	third.init(m_Dms);
+	third.getFeatures().set("movement", 1.0f);
+	third.getFeatures().set("defense", 4.5f);
+	store.add(third);
+	ASSERT_TRUE(store.flush());
+	EXPECT_EQ(3u, store.size());
+	EXPECT_EQ(3u, store.getSchema().size());
+	store.load(2, third, weights);
+	EXPECT_FLOAT_EQ(4.5f, third.getFeatures().get("defense"));
+	EXPECT_FLOAT_EQ(0.0f, third.getFeatures().get("aggression"));
+}
+
+TEST_F(ProfileStoreTest, SessionsShareTheFile) {
+	ProfileStore first;
+	ProfileStore second;
+	ASSERT_TRUE(first.open(m_Path));
+	ASSERT_TRUE(second.open(m_Path));
+	addProfile(first, 1, 10, 20);
+	{
+		// The second session interns its own names first
+		Profile profile;
+		profile.init(m_Dms);
+		profile.getFeatures().set("defense", 2.0f);
+		second.add(profile);
+	}
+	addProfile(second, 2, 30, 40);
+	ASSERT_TRUE(first.flush());
+	ASSERT_TRUE(second.flush());
+
+	// Nothing flushed by the first session was overwritten, the names of the second one were added to the file's
+	ProfileStore store;
+	ASSERT_TRUE(store.open(m_Path));
+	ASSERT_EQ(3u, store.size());
+	FeatureVector features;
+	store.loadFeatures(0, features);
+	EXPECT_FLOAT_EQ(1.0f, features.get("aggression"));
+	store.loadFeatures(1, features);
+	EXPECT_FLOAT_EQ(2.0f, features.get("defense"));
+	EXPECT_FLOAT_EQ(0.0f, features.get("aggression"));
+	store.loadFeatures(2, features);
+	EXPECT_FLOAT_EQ(2.0f, features.get("aggression"));
+	EXPECT_FLOAT_EQ(3.0f, features.get("movement"));
+}
+
+static void flushProfiles(const string& path, vector<DecisionMaking*> dms, int session)
+{
+	ProfileStore store;
+	store.open(path);
+	for (int i = 0; i < 10; i++)
+	{
+		Profile profile;
+		profile.init(dms);
+		profile.getFeatures().set("session", (float)session);
+		store.add(profile);
+		store.flush();
+	}
+}
+
+TEST_F(ProfileStoreTest, ConcurrentFlushes) {
+	ProfileStore store;
+	ASSERT_TRUE(store.open(m_Path));
+	store.close();
+
+	boost::thread_group threads;
+	for (int session = 1; session <= 4; session++)
+	{
+		threads.create_thread(boost::bind(&flushProfiles, m_Path, m_Dms, session));
+	}
+	threads.join_all();
+
+	ASSERT_TRUE(store.open(m_Path));
+	ASSERT_EQ(40u, store.size());
+	int counts[5] = { 0, 0, 0, 0, 0 };
+	FeatureVector features;
+	for (size_t i = 0; i < store.size(); i++)
+	{
+		store.loadFeatures(i, features);
+		counts[(int)features.get("session")]++;
+	}
+	for (int session = 1; session <= 4; session++)
+	{
+		EXPECT_EQ(10, counts[session]);
+	}
+}
+
+TEST_F(ProfileStoreTest, ConvertsVersionOne) {
+	{
+		// Header, the name "defense" and a profile of one feature, -3 as int32, and one weight of 300
+		const unsigned char bytes[] = {
+			0x48, 0x50, 0x52, 0x46, 1, 0, 0, 0,
+			ProfileStore::RECORD_NAME, 7, 'd', 'e', 'f', 'e', 'n', 's', 'e',
+			ProfileStore::RECORD_PROFILE, 1, 1, 0, 0, 0, 0xFD, 0xFF, 0xFF, 0xFF, 0x2C, 0x01, 0, 0,
+		};
+		ofstream file(m_Path.c_str(), ios::binary);
+		file.write((const char*)bytes, sizeof(bytes));
+	}
+
+	ProfileStore store;
+	ASSERT_TRUE(store.open(m_Path));
+	EXPECT_EQ(1, store.getVersion());
+	ASSERT_EQ(1u, store.size());
+	WeightMatrix weights(m_Dms);
+	Profile profile;
+	store.load(0, profile, weights);
+	EXPECT_FLOAT_EQ(-3.0f, profile.getFeatures().get("defense"));
+	EXPECT_EQ(300, profile.getWeight(0));
+
+	// Appending converts the whole file
+	addProfile(store, 4, 10, 20);
+	ASSERT_TRUE(store.flush());
+	EXPECT_EQ(ProfileStore::VERSION, store.getVersion());
+	ASSERT_EQ(2u, store.size());
+	FeatureVector features;
+	store.loadFeatures(0, features);
+	EXPECT_FLOAT_EQ(-3.0f, features.get("defense"));
+	store.loadFeatures(1, features);
+	EXPECT_FLOAT_EQ(4.0f, features.get("aggression"));
+	EXPECT_FLOAT_EQ(3.0f, features.get("movement"));
+}
+
+TEST_F(ProfileStoreTest, RejectsOtherFormats) {
+	{
+		ofstream file(m_Path.c_str(), ios::binary);
+		file << "not a profile store";
+	}
+	ProfileStore store;
+	EXPECT_FALSE(store.open(m_Path));
+	EXPECT_FALSE(store.isOpen());
+}
+
+TEST_F(ProfileStoreTest, IgnoresTornRecord) {
+	{
+		ProfileStore store;
+		ASSERT_TRUE(store.open(m_Path));
+		addProfile(store, 1, 10, 20);
+		ASSERT_TRUE(store.flush());
+	}
+	{
+		// A profile record cut short
+		ofstream file(m_Path.c_str(), ios::binary | ios::app);
+		file.put(ProfileStore::RECORD_PROFILE);
+		file.put(2);
+	}
+
+	ProfileStore store;
+	ASSERT_TRUE(store.open(m_Path));
+	EXPECT_EQ(1u, store.size());
+
+	addProfile(store, 2, 10, 20);
+	ASSERT_TRUE(store.flush());
+	EXPECT_EQ(2u, store.size());
+}
+
+TEST_F(ProfileStoreTest, CutsOffLongTornRecord) {
+	{
+		ProfileStore store;
+		ASSERT_TRUE(store.open(m_Path));
+		addProfile(store, 1, 10, 20);
+		ASSERT_TRUE(store.flush());
+	}
+	streamoff validSize;
+	{
+		// A profile record cut short, longer than the one appended next, left over it would read as names
+		ofstream file(m_Path.c_str(), ios::binary | ios::app);
+		validSize = file.tellp();
+		file.put(ProfileStore::RECORD_PROFILE);
+		file.put(2);
+		for (int i = 0; i < 64; i++)
+		{
+			file.put(ProfileStore::RECORD_NAME);
+		}
+	}
+
+	{
+		ProfileStore store;
+		ASSERT_TRUE(store.open(m_Path));
+		addProfile(store, 2, 10, 20);
+		ASSERT_TRUE(store.flush());
+	}
+
+	ProfileStore store;
+	ASSERT_TRUE(store.open(m_Path));
+	EXPECT_EQ(2u, store.size());
+	EXPECT_EQ(2u, store.getSchema().size());
+	ifstream file(m_Path.c_str(), ios::binary | ios::ate);
+	EXPECT_LT(file.tellg(), validSize + 66);
+}
+
+TEST_F(ProfileStoreTest, ProfileManagerLoadsAndSaves) {
+	ProfileStore store;
+	ASSERT_TRUE(store.open(m_Path));
+	addProfile(store, 1, 10, 900);
+	ASSERT_TRUE(store.flush());
+
+	FixedProfileManager manager(m_Dms);
+	manager.setProfileLibrary(&store);
+	manager.init();
+
+	// Starts from the last stored profile
+	Profile* current = manager.getCurrentProfile();
+	EXPECT_EQ(900, current->getCurrentWeight());
+
+	// Nothing changed, nothing to save
+	manager.save();
+	EXPECT_EQ(0u, store.getPendingCount());
+
+	manager.alert();
+	manager.save();
+	EXPECT_EQ(1u, store.getPendingCount());
+	ASSERT_TRUE(store.flush());
+	EXPECT_EQ(2u, store.size());
+}
@@ -0,0 +1,44 @@
+#include "../../tools/Random.h"
+#include "gtest/gtest.h"
+
+TEST(RandomTest, SameSeedSameSequence) {
+	Random a(42);
+	Random b(42);
+
+	for (int i = 0; i < 1000; i++)
+	{
+		ASSERT_EQ(a.next(), b.next());
+	}
+}
+
+TEST(RandomTest, StreamsDiffer) {
+	Random a(42, Random::hash("Blue0"));
+	Random b(42, Random::hash("Blue1"));
+	Random c(43, Random::hash("Blue0"));
+
+	EXPECT_NE(a.next(), b.next());
+	EXPECT_NE(Random(42, Random::hash("Blue0")).next(), c.next());
+}
+
+TEST(RandomTest, Ranges) {
+	Random random(7);
+	int counts[3] = { 0, 0, 0 };
+
+	for (int i = 0; i < 30000; i++)
+	{
+		float f = random.nextFloat();
+		ASSERT_GE(f, 0.0f);
+		ASSERT_LT(f, 1.0f);
+
+		unsigned n = random.nextInt(3);
+		ASSERT_LT(n, 3u);
+		counts[n]++;
+	}
+
+	// Roughly uniform
+	for (int i = 0; i < 3; i++)
+	{
+		EXPECT_GT(counts[i], 9000);
+		EXPECT_LT(counts[i], 11000);
+	}
+}
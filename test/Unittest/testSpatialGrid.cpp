@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include "../../../api/GameInfo.h"
+#include "../../SpatialGrid.hpp"
+
+/** Test fixture with a level blocked everywhere but a few cells */
+class SpatialGridTest : public testing::Test
+{
+protected:
+	LevelInfo m_level;
+	SpatialGrid m_grid;
+
+	virtual void SetUp() {
+		m_level.width = 20;
+		m_level.height = 10;
+		m_level.blockHeights.assign(m_level.width, vector<float>(m_level.height, 0.0f));
+	}
+};
+
+TEST_F(SpatialGridTest, RandomFreePosition) {
+	for (int x = 0; x < m_level.width; x++)
+	{
+		for (int y = 0; y < m_level.height; y++)
+		{
+			m_level.blockHeights[x][y] = 1.0f;
+		}
+	}
+	m_level.blockHeights[3][4] = 0.0f;
+	m_level.blockHeights[17][9] = 0.0f;
+	m_grid.build(m_level);
+
+	EXPECT_EQ(2u, m_grid.getFreeCellCount());
+	EXPECT_TRUE(m_grid.isFree(3, 4));
+	EXPECT_FALSE(m_grid.isFree(4, 3));
+	EXPECT_FALSE(m_grid.isFree(-1, 0));
+
+	Random random(5);
+	int hits[2] = { 0, 0 };
+	for (int i = 0; i < 200; i++)
+	{
+		Vector2 position;
+		ASSERT_TRUE(m_grid.findRandomFreePosition(random, position));
+		ASSERT_TRUE(m_grid.isFree((int)position.x, (int)position.y));
+		hits[(int)position.x == 3 ? 0 : 1]++;
+	}
+	EXPECT_GT(hits[0], 50);
+	EXPECT_GT(hits[1], 50);
+
+	// The same seed draws the same positions
+	Random a(9), b(9);
+	Vector2 first, second;
+	m_grid.findRandomFreePosition(a, first);
+	m_grid.findRandomFreePosition(b, second);
+	EXPECT_EQ(first, second);
+
+	m_level.blockHeights[3][4] = m_level.blockHeights[17][9] = 1.0f;
+	m_grid.build(m_level);
+	EXPECT_FALSE(m_grid.findRandomFreePosition(random, first));
+}
+
+TEST_F(SpatialGridTest, RadiusAndNearest) {
+	m_grid.build(m_level);
+	m_grid.setBot(0, Vector2(1.0f, 1.0f), true);
+	m_grid.setBot(1, Vector2(2.0f, 1.5f), false);
+	m_grid.setBot(2, Vector2(18.0f, 9.0f), false);
+	m_grid.setBot(3, Vector2(6.0f, 1.0f), true);
+
+	vector<BotId> found;
+	m_grid.findInRadius(Vector2(1.0f, 1.0f), 5.0f, SpatialGrid::ANY_TEAM, found);
+	ASSERT_EQ(3u, found.size());
+	EXPECT_EQ(0u, found[0]);
+	EXPECT_EQ(1u, found[1]);
+	EXPECT_EQ(3u, found[2]);
+	m_grid.findInRadius(Vector2(1.0f, 1.0f), 5.0f, SpatialGrid::ENEMY_TEAM, found);
+	ASSERT_EQ(1u, found.size());
+	EXPECT_EQ(1u, found[0]);
+
+	EXPECT_EQ(1u, m_grid.findNearest(Vector2(1.0f, 1.0f), SpatialGrid::ANY_TEAM, 0));
+	EXPECT_EQ(3u, m_grid.findNearest(Vector2(1.0f, 1.0f), SpatialGrid::OWN_TEAM, 0));
+	EXPECT_EQ(2u, m_grid.findNearest(Vector2(19.0f, 0.0f), SpatialGrid::ENEMY_TEAM));
+	EXPECT_EQ(NO_BOT, m_grid.findNearest(Vector2(19.0f, 0.0f), SpatialGrid::OWN_TEAM, NO_BOT, 5.0f));
+
+	// Bots follow their positions across buckets and leave when removed
+	m_grid.setBot(2, Vector2(1.5f, 1.0f), false);
+	EXPECT_EQ(2u, m_grid.findNearest(Vector2(1.0f, 1.0f), SpatialGrid::ENEMY_TEAM));
+	m_grid.removeBot(2);
+	EXPECT_FALSE(m_grid.contains(2));
+	EXPECT_EQ(1u, m_grid.findNearest(Vector2(1.0f, 1.0f), SpatialGrid::ENEMY_TEAM));
+}
+
+TEST_F(SpatialGridTest, NearestMatchesScan) {
+	m_level.width = 64;
+	m_level.height = 48;
+	m_level.blockHeights.assign(m_level.width, vector<float>(m_level.height, 0.0f));
+	m_grid.build(m_level);
+
+	Random random(3);
+	vector<Vector2> positions;
+	for (BotId id = 0; id < 40; id++)
+	{
+		positions.push_back(Vector2(random.nextFloat() * 64.0f, random.nextFloat() * 48.0f));
+		m_grid.setBot(id, positions.back(), id % 2 == 0);
+	}
+
+	for (int i = 0; i < 100; i++)
+	{
+		Vector2 query(random.nextFloat() * 64.0f, random.nextFloat() * 48.0f);
+		BotId expected = NO_BOT;
+		float best = numeric_limits<float>::max();
+		for (BotId id = 0; id < positions.size(); id++)
+		{
+			float distance = query.distance(positions[id]);
+			if (id % 2 == 1 && distance < best)
+			{
+				best = distance;
+				expected = id;
+			}
+		}
+		ASSERT_EQ(expected, m_grid.findNearest(query, SpatialGrid::ENEMY_TEAM));
+	}
+}
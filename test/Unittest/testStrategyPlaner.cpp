@@ -0,0 +1,265 @@
+#include <boost/optional.hpp>
+#include <gtest/gtest.h>
+
+#include "../../../api/Vector2.h"
+#include "../../../api/Commands.h"
+#include "../../../api/GameInfo.h"
+#include "../../StrategyPlaner.hpp"
+
+/** Library keeping the features and weights of the added profiles */
+class RecordingLibrary : public ProfileLibrary
+{
+public:
+	vector<FeatureVector> m_Features;
+	vector<vector<int> > m_Weights;
+
+	virtual size_t size() const { return 0; }
+	virtual void load(size_t index, Profile& profile, WeightMatrix& weights) const {}
+	virtual void loadFeatures(size_t index, FeatureVector& features) const {}
+
+	virtual void add(Profile& profile)
+	{
+		m_Features.push_back(profile.getFeatures());
+		m_Weights.push_back(vector<int>());
+		for (size_t i = 0; i < profile.getDecisionMakerCount(); i++)
+		{
+			m_Weights.back().push_back(profile.getWeight(i));
+		}
+	}
+};
+
+/** Test fixture with a small game of three bots per team */
+class StrategyPlanerTest : public testing::Test
+{
+protected:
+	GameInfo m_game;
+	LevelInfo m_level;
+	BotRegistry m_registry;
+
+	BotInfo* addBot(TeamInfo& team, const string& name, const Vector2& position)
+	{
+		BotInfo* bot = new BotInfo();
+		bot->name = name;
+		bot->team = &team;
+		bot->position = position;
+		bot->health = 100.0f;
+		bot->flag = NULL;
+		m_game.bots[name].reset(bot);
+		team.members.push_back(bot);
+		return bot;
+	}
+
+	TeamInfo* addTeam(const string& name, const Vector2& base)
+	{
+		TeamInfo* team = new TeamInfo();
+		team->name = name;
+		team->flagScoreLocation = base;
+		team->flagSpawnLocation = base;
+
+		FlagInfo* flag = new FlagInfo();
+		flag->name = name + "Flag";
+		flag->team = team;
+		flag->position = base;
+		flag->carrier = NULL;
+		team->flag = flag;
+
+		m_game.flags[flag->name].reset(flag);
+		m_game.teams[name].reset(team);
+		return team;
+	}
+
+	virtual void SetUp() {
+		m_level.width = 40;
+		m_level.height = 20;
+		m_level.blockHeights.assign(m_level.width, vector<float>(m_level.height, 0.0f));
+
+		m_game.match.reset(new MatchInfo());
+		m_game.match->timePassed = 0.0f;
+		m_game.team = addTeam("Blue", Vector2(5.0f, 10.0f));
+		m_game.enemyTeam = addTeam("Red", Vector2(35.0f, 10.0f));
+
+		for (int i = 0; i < 3; i++)
+		{
+			m_game.bots_alive.push_back(addBot(*m_game.team, "Blue" + to_string(i), Vector2(5.0f, 8.0f + i)));
+			addBot(*m_game.enemyTeam, "Red" + to_string(i), Vector2(35.0f, 8.0f + i));
+		}
+		m_registry.init(m_game);
+	}
+};
+
+TEST_F(StrategyPlanerTest, Init) {
+	StrategyPlaner planer(m_game, m_level, m_registry);
+	planer.init();
+
+	EXPECT_EQ(3u, planer.getBotCount());
+	EXPECT_TRUE(planer.tick().empty());
+}
+
+TEST_F(StrategyPlanerTest, TicksAvailableBots) {
+	StrategyPlaner planer(m_game, m_level, m_registry, 7);
+	planer.init();
+
+	m_game.bots_available.push_back(m_game.team->members[2]);
+	m_game.bots_available.push_back(m_game.team->members[0]);
+
+	vector<const Command*> commands;
+	planer.tick(commands);
+
+	// Commands come in bot order, whatever the order of availability
+	ASSERT_EQ(2u, commands.size());
+	EXPECT_EQ("Blue0", commands[0]->botId);
+	EXPECT_EQ("Blue2", commands[1]->botId);
+	ASSERT_EQ(2u, planer.getCommandBots().size());
+	EXPECT_EQ(m_registry.getId(*m_game.team->members[0]), planer.getCommandBots()[0]);
+	EXPECT_EQ(m_registry.getId(*m_game.team->members[2]), planer.getCommandBots()[1]);
+
+	// Dead bots are skipped, but keep their entry
+	m_game.bots_alive.erase(m_game.bots_alive.begin());
+	planer.tick(commands);
+
+	ASSERT_EQ(1u, commands.size());
+	EXPECT_EQ("Blue2", commands[0]->botId);
+	EXPECT_EQ(3u, planer.getBotCount());
+}
+
+TEST_F(StrategyPlanerTest, ParallelMatchesSerial) {
+	StrategyPlaner serial(m_game, m_level, m_registry, 11);
+	StrategyPlaner parallel(m_game, m_level, m_registry, 11);
+	serial.init();
+	parallel.init();
+	parallel.setThreadCount(4);
+
+	m_game.bots_available = m_game.bots_alive;
+
+	for (int tick = 0; tick < 20; tick++)
+	{
+		vector<const Command*> expected = serial.tick();
+		vector<const Command*> actual = parallel.tick();
+
+		// Random targets are drawn from every bot's own stream, so they match as well
+		ASSERT_EQ(expected.size(), actual.size());
+		for (size_t i = 0; i < expected.size(); i++)
+		{
+			EXPECT_EQ(expected[i]->botId, actual[i]->botId);
+			EXPECT_EQ(static_cast<const AttackCommand*>(expected[i])->target, static_cast<const AttackCommand*>(actual[i])->target);
+		}
+	}
+}
+
+TEST_F(StrategyPlanerTest, TeamMonitor) {
+	StrategyPlaner planer(m_game, m_level, m_registry);
+	planer.init();
+	const TeamMonitor& monitor = planer.getMonitor();
+	EXPECT_EQ(4u, monitor.getConditionCount());
+
+	planer.tick();
+	EXPECT_EQ(0u, monitor.getAlertCount());
+
+	// Losing the flag alerts once, not on every tick it stays lost
+	m_game.team->flag->carrier = m_game.enemyTeam->members[0];
+	planer.tick();
+	planer.tick();
+	EXPECT_EQ(1u, monitor.getAlertCount());
+
+	// Another condition becoming met alerts again
+	m_game.match->scores["Red"] = 2;
+	planer.tick();
+	EXPECT_EQ(2u, monitor.getAlertCount());
+
+	// Without progress for long enough
+	m_game.match->timePassed = 61.0f;
+	planer.tick();
+	EXPECT_EQ(3u, monitor.getAlertCount());
+	EXPECT_TRUE(monitor.isMet(3));
+
+	// A kill of ours in the events of the tick is progress, seen on that very tick
+	MatchCombatEvent event;
+	event.type = MatchCombatEvent::TYPE_KILLED;
+	event.time = 61.5f;
+	event.killedEventData.instigator = m_game.team->members[0];
+	event.killedEventData.subject = m_game.enemyTeam->members[0];
+	m_game.match->combatEvents.push_back(event);
+	m_game.match->timePassed = 62.0f;
+	planer.tick();
+	EXPECT_FALSE(monitor.isMet(3));
+}
+
+TEST_F(StrategyPlanerTest, WorldSnapshot) {
+	m_game.bots_available.push_back(m_game.team->members[1]);
+	m_game.team->flag->carrier = m_game.enemyTeam->members[2];
+	m_game.match->scores["Blue"] = 1;
+
+	MatchCombatEvent event;
+	event.type = MatchCombatEvent::TYPE_RESPAWN;
+	event.respawnEventData.subject = m_game.team->members[0];
+	m_game.match->combatEvents.push_back(event);
+
+	WorldSnapshot world;
+	world.build(m_game, m_level, m_registry);
+
+	EXPECT_EQ(6u, world.getBotCount());
+	EXPECT_EQ(Vector2(35.0f, 9.0f), world.getPosition(4));
+	EXPECT_TRUE(world.isAlive(4));
+	EXPECT_FALSE(world.isAvailable(0));
+	EXPECT_TRUE(world.isAvailable(1));
+	EXPECT_EQ(5u, world.getOwnFlagCarrier());
+	EXPECT_EQ(NO_BOT, world.getEnemyFlagCarrier());
+	EXPECT_TRUE(world.isOwnFlag(m_game.team->flag));
+	EXPECT_FALSE(world.isOwnFlag(m_game.enemyTeam->flag));
+	EXPECT_EQ(1, world.getScore());
+	EXPECT_EQ(0, world.getEnemyScore());
+	EXPECT_EQ(0u, world.getFirstNewEvent());
+	EXPECT_EQ(1u, world.getEndEvent());
+
+	// Only the events added since the last build are new
+	m_game.match->combatEvents.push_back(event);
+	world.build(m_game, m_level, m_registry);
+	EXPECT_EQ(1u, world.getFirstNewEvent());
+	EXPECT_EQ(2u, world.getEndEvent());
+	world.build(m_game, m_level, m_registry);
+	EXPECT_EQ(2u, world.getFirstNewEvent());
+	EXPECT_EQ(2u, world.getEndEvent());
+
+	// Our bots are alive while listed as such, whatever their health
+	EXPECT_TRUE(world.isAlive(0));
+	m_game.bots_alive.erase(m_game.bots_alive.begin());
+	world.build(m_game, m_level, m_registry);
+	EXPECT_FALSE(world.isAlive(0));
+}
+
+TEST_F(StrategyPlanerTest, BotRegistry) {
+	EXPECT_EQ(6u, m_registry.size());
+
+	// Ids follow the bot names
+	EXPECT_EQ(0u, m_registry.getId(*m_game.bots["Blue0"]));
+	EXPECT_EQ(3u, m_registry.getId(*m_game.bots["Red0"]));
+	EXPECT_EQ("Blue2", m_registry.getBot(2).name);
+	EXPECT_TRUE(m_registry.isOwnTeam(1));
+	EXPECT_FALSE(m_registry.isOwnTeam(4));
+
+	BotInfo stranger;
+	EXPECT_EQ(NO_BOT, m_registry.getId(stranger));
+}
+
+TEST_F(StrategyPlanerTest, SavesEveryStyleOnce) {
+	RecordingLibrary library;
+	StrategyPlaner planer(m_game, m_level, m_registry);
+	planer.setProfileLibrary(&library);
+	planer.init();
+
+	// Nothing learned, nothing to save
+	planer.saveProfiles();
+	EXPECT_TRUE(library.m_Features.empty());
+
+	// Every bot learned on the default profile, which is saved once
+	planer.reward(1.0f);
+	planer.applyRewards();
+	planer.saveProfiles();
+	ASSERT_EQ(1u, library.m_Features.size());
+	EXPECT_EQ(0u, library.m_Features[0].count());
+	ASSERT_FALSE(library.m_Weights[0].empty());
+	EXPECT_EQ(planer.getCurrentWeight(0), library.m_Weights[0][0]);
+
+	planer.saveProfiles();
+	EXPECT_EQ(1u, library.m_Features.size());
+}
@@ -0,0 +1,63 @@
+#include <vector>
+#include "../../tools/TaskPool.h"
+#include "gtest/gtest.h"
+
+class TaskRecorder
+{
+public:
+	TaskRecorder(size_t tasks): m_Calls(tasks) {
+		for (size_t i = 0; i < tasks; i++)
+		{
+			m_Calls[i] = 0;
+		}
+	}
+
+	void run(size_t index) {
+		m_Calls[index]++;
+	}
+
+	vector<boost::atomic<int> > m_Calls;
+};
+
+TEST(TaskPoolTest, SingleThread) {
+	TaskPool pool(1);
+	EXPECT_EQ(1u, pool.getThreadCount());
+
+	TaskRecorder recorder(10);
+	pool.run(10, TaskPool::Task(&recorder, &TaskRecorder::run));
+
+	for (size_t i = 0; i < 10; i++)
+	{
+		EXPECT_EQ(1, recorder.m_Calls[i]);
+	}
+}
+
+TEST(TaskPoolTest, RunsEveryTaskOnce) {
+	TaskPool pool(4);
+	EXPECT_EQ(4u, pool.getThreadCount());
+
+	// Repeated runs reuse the same workers
+	for (int run = 0; run < 50; run++)
+	{
+		TaskRecorder recorder(1000);
+		pool.run(1000, TaskPool::Task(&recorder, &TaskRecorder::run));
+
+		for (size_t i = 0; i < 1000; i++)
+		{
+			ASSERT_EQ(1, recorder.m_Calls[i]);
+		}
+	}
+}
+
+TEST(TaskPoolTest, FewerTasksThanThreads) {
+	TaskPool pool(8);
+
+	TaskRecorder recorder(3);
+	pool.run(3, TaskPool::Task(&recorder, &TaskRecorder::run));
+	pool.run(0, TaskPool::Task(&recorder, &TaskRecorder::run));
+
+	for (size_t i = 0; i < 3; i++)
+	{
+		EXPECT_EQ(1, recorder.m_Calls[i]);
+	}
+}
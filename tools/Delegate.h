@@ -1,85 +1,162 @@
 #pragma once
 
-/********************
-* CALLBACK CLASS
-********************/
-template <typename Ret, typename Param0>
-class Callback
-{
-public:
-	virtual Ret invoke(Param0 param0) = 0;
-};
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 /********************
-* STATIC CALLBACK CLASS
+* DELEGATE CLASS
+*
+* Callback to a free function, a member function or a small functor.
+* The callable is stored inline and invoked through a plain function pointer,
+* so delegates never allocate, never dispatch virtually and are copied like PODs.
+* Functors have to be trivially copyable and fit into the inline storage,
+* which holds lambdas capturing up to a few pointers.
 ********************/
-template <typename Ret, typename Param0>
-class StaticFunctionCallback : public Callback<Ret, Param0>
+template <typename Signature>
+class Delegate;
+
+template <typename Ret, typename... Params>
+class Delegate<Ret (Params...)>
 {
 private:
-	Ret (*func_)(Param0);
+	enum { STORAGE_SIZE = 4 * sizeof(void*) };
 
-public:
-	StaticFunctionCallback(Ret (*func)(Param0))
-		: func_(func)
-	{}
+	union Storage
+	{
+		void* align_;
+		void (*alignFunc_)();
+		char buffer_[STORAGE_SIZE];
+	};
+
+	typedef Ret (*Stub)(const Storage& storage, Params... params);
+
+	Storage storage_;
+	Stub stub_;
 
-	virtual Ret invoke(Param0 param0)
+	template <typename Class, typename Method>
+	struct MethodBinding
 	{
-		return (*func_)(param0);
+		Class* object;
+		Method method;
+	};
+
+	template <typename Callable>
+	void store(const Callable& callable)
+	{
+		static_assert(sizeof(Callable) <= sizeof(Storage), "Callable does not fit into the delegate storage");
+		static_assert(std::alignment_of<Callable>::value <= std::alignment_of<Storage>::value, "Callable is over-aligned for the delegate storage");
+		static_assert(std::is_trivially_copyable<Callable>::value, "Callable has to be trivially copyable");
+		// Unused bytes are cleared so that delegates can be compared bytewise
+		std::memset(storage_.buffer_, 0, sizeof(Storage));
+		new (storage_.buffer_) Callable(callable);
 	}
-};
 
-/********************
-* METHOD CALLBACK CLASS
-********************/
-template <typename Ret, typename Param0, typename T, typename Method>
-class MethodCallback : public Callback<Ret, Param0>
-{
-private:
-	void *object_;
-	Method method_;
+	template <typename Callable>
+	static const Callable& stored(const Storage& storage)
+	{
+		return *reinterpret_cast<const Callable*>(storage.buffer_);
+	}
 
-public:
-	MethodCallback(void *object, Method method)
-		: object_(object)
-		, method_(method)
-	{}
+	static Ret functionStub(const Storage& storage, Params... params)
+	{
+		return (*stored<Ret (*)(Params...)>(storage))(std::forward<Params>(params)...);
+	}
 
-	virtual Ret invoke(Param0 param0)
+	template <typename Class, typename Method>
+	static Ret methodStub(const Storage& storage, Params... params)
 	{
-		T *obj = static_cast<T *>(object_);
-		return (obj->*method_)(param0);
+		const MethodBinding<Class, Method>& binding = stored<MethodBinding<Class, Method> >(storage);
+		return (binding.object->*binding.method)(std::forward<Params>(params)...);
 	}
-};
 
-/********************
-* DELEGATE CLASS
-********************/
-template <typename Ret, typename Param0>
-class Delegate
-{
-private:
-	Callback<Ret, Param0> *callback_;
+	template <typename Functor>
+	static Ret functorStub(const Storage& storage, Params... params)
+	{
+		return stored<Functor>(storage)(std::forward<Params>(params)...);
+	}
 
 public:
-	Delegate(Ret)
-		:callback_(new StaticFunctionCallback<Ret, void>(func))
+	Delegate()
+		: stub_(NULL)
 	{}
 
-	Delegate(Ret (*func)(Param0))
-		:callback_(new StaticFunctionCallback<Ret, Param0>(func))
-	{}
+	Delegate(Ret (*func)(Params...))
+		: stub_(NULL)
+	{
+		bind(func);
+	}
 
 	template <typename T, typename Method>
 	Delegate(T *object, Method method)
-		:callback_(new MethodCallback<Ret, Param0, T, Method>(object, method))
-	{}
+		: stub_(NULL)
+	{
+		bind(object, method);
+	}
 
-	~Delegate(void) { delete callback_; }
+	void bind(Ret (*func)(Params...))
+	{
+		if (func == NULL)
+		{
+			clear();
+			return;
+		}
+		store(func);
+		stub_ = &functionStub;
+	}
 
-	Ret operator()(Param0 param0)
+	template <typename T, typename Class>
+	void bind(T *object, Ret (Class::*method)(Params...))
 	{
-		return callback_->invoke(param0);
+		MethodBinding<Class, Ret (Class::*)(Params...)> binding = { static_cast<Class*>(object), method };
+		store(binding);
+		stub_ = &methodStub<Class, Ret (Class::*)(Params...)>;
 	}
+
+	template <typename T, typename Class>
+	void bind(const T *object, Ret (Class::*method)(Params...) const)
+	{
+		MethodBinding<const Class, Ret (Class::*)(Params...) const> binding = { static_cast<const Class*>(object), method };
+		store(binding);
+		stub_ = &methodStub<const Class, Ret (Class::*)(Params...) const>;
+	}
+
+	template <typename Functor>
+	void bind(const Functor& functor)
+	{
+		store(functor);
+		stub_ = &functorStub<Functor>;
+	}
+
+	/**
+	* Creates a delegate from a lambda or any other small functor.
+	*/
+	template <typename Functor>
+	static Delegate fromFunctor(const Functor& functor)
+	{
+		Delegate delegate;
+		delegate.bind(functor);
+		return delegate;
+	}
+
+	void clear() { stub_ = NULL; }
+
+	bool empty() const { return stub_ == NULL; }
+
+	Ret operator()(Params... params) const
+	{
+		return stub_(storage_, std::forward<Params>(params)...);
+	}
+
+	/**
+	* Two delegates are equal if they call the same target.
+	*/
+	bool operator==(const Delegate& other) const
+	{
+		return stub_ == other.stub_ && (stub_ == NULL || std::memcmp(storage_.buffer_, other.storage_.buffer_, sizeof(Storage)) == 0);
+	}
+
+	bool operator!=(const Delegate& other) const { return !(*this == other); }
 };
@@ -0,0 +1,293 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <boost/cstdint.hpp>
+
+using namespace std;
+
+/**
+* Latency histogram with logarithmic buckets, eight per power of two.
+* Percentiles are exact below 16ns and within 12.5% above.
+*/
+class LatencyHistogram
+{
+public:
+	LatencyHistogram()
+		: m_Buckets(BUCKET_COUNT, 0)
+	{
+		reset();
+	}
+
+	void record(boost::uint64_t nanoseconds)
+	{
+		++m_Buckets[bucketOf(nanoseconds)];
+		++m_Count;
+		m_Total += nanoseconds;
+		if (nanoseconds > m_Max)
+		{
+			m_Max = nanoseconds;
+		}
+	}
+
+	void merge(const LatencyHistogram& other)
+	{
+		for (size_t i = 0; i < BUCKET_COUNT; ++i)
+		{
+			m_Buckets[i] += other.m_Buckets[i];
+		}
+		m_Count += other.m_Count;
+		m_Total += other.m_Total;
+		if (other.m_Max > m_Max)
+		{
+			m_Max = other.m_Max;
+		}
+	}
+
+	void reset()
+	{
+		fill(m_Buckets.begin(), m_Buckets.end(), 0);
+		m_Count = 0;
+		m_Total = 0;
+		m_Max = 0;
+	}
+
+	boost::uint64_t getCount() const { return m_Count; }
+	boost::uint64_t getMax() const { return m_Max; }
+	boost::uint64_t getMean() const { return m_Count > 0 ? m_Total / m_Count : 0; }
+
+	/**
+	* Latency below which the given fraction (0..1) of all samples fall.
+	*/
+	boost::uint64_t getPercentile(double fraction) const
+	{
+		if (m_Count == 0)
+		{
+			return 0;
+		}
+
+		boost::uint64_t rank = (boost::uint64_t)(fraction * m_Count);
+		if (rank >= m_Count)
+		{
+			rank = m_Count - 1;
+		}
+
+		boost::uint64_t seen = 0;
+		for (size_t i = 0; i < BUCKET_COUNT; ++i)
+		{
+			seen += m_Buckets[i];
+			if (seen > rank)
+			{
+				boost::uint64_t upper = upperBoundOf(i);
+				return upper < m_Max ? upper : m_Max;
+			}
+		}
+		return m_Max;
+	}
+
+private:
+	enum { LINEAR = 16, SUB_BUCKETS = 8, BUCKET_COUNT = LINEAR + (64 - 4) * SUB_BUCKETS };
+
+	vector<boost::uint64_t> m_Buckets;
+	boost::uint64_t m_Count;
+	boost::uint64_t m_Total;
+	boost::uint64_t m_Max;
+
+	static size_t bucketOf(boost::uint64_t value)
+	{
+		if (value < LINEAR)
+		{
+			return (size_t)value;
+		}
+
+		int octave = 63;
+		while ((value >> octave) == 0)
+		{
+			--octave;
+		}
+		size_t sub = (size_t)(value >> (octave - 3)) & (SUB_BUCKETS - 1);
+		return LINEAR + (octave - 4) * SUB_BUCKETS + sub;
+	}
+
+	static boost::uint64_t upperBoundOf(size_t bucket)
+	{
+		if (bucket < LINEAR)
+		{
+			return bucket;
+		}
+
+		int octave = 4 + (int)(bucket - LINEAR) / SUB_BUCKETS;
+		boost::uint64_t sub = (bucket - LINEAR) % SUB_BUCKETS;
+		return ((SUB_BUCKETS + sub + 1) << (octave - 3)) - 1;
+	}
+};
+
+/**
+* Measures the lifetime of the scope it lives in.
+* A timer without histogram does nothing, not even reading the clock.
+*/
+class ScopedTimer
+{
+public:
+	explicit ScopedTimer(LatencyHistogram* histogram)
+		: m_pHistogram(histogram)
+	{
+		if (m_pHistogram != NULL)
+		{
+			m_Start = chrono::steady_clock::now();
+		}
+	}
+
+	~ScopedTimer()
+	{
+		if (m_pHistogram != NULL)
+		{
+			m_pHistogram->record(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - m_Start).count());
+		}
+	}
+
+private:
+	LatencyHistogram* m_pHistogram;
+	chrono::steady_clock::time_point m_Start;
+};
+
+/**
+* Latencies and counters of the commander pipeline, broken down by stage and by bot.
+* Disabled by default; while disabled, timers are never started and counters never touched.
+*
+* Each bot histogram is only written by the thread ticking that bot, the stage histograms
+* and counters only by the thread driving the commander.
+*/
+class Instrumentation
+{
+public:
+	enum Stage
+	{
+		STAGE_COMMANDER,
+		STAGE_PLANER,
+		STAGE_CDMS,
+		STAGE_FLUSH,
+		STAGE_COUNT,
+	};
+
+	enum Counter
+	{
+		COUNTER_TICKS,
+		COUNTER_COMMANDS,
+		COUNTER_BYTES,
+		COUNTER_SUPPRESSED,
+		COUNTER_COUNT,
+	};
+
+	Instrumentation()
+		: m_Enabled(false), m_Stages(STAGE_COUNT), m_Counters(COUNTER_COUNT, 0) {}
+
+	void setEnabled(bool enabled) { m_Enabled = enabled; }
+	bool isEnabled() const { return m_Enabled; }
+
+	/**
+	* Histogram of a stage, NULL while disabled so that timers stay idle.
+	*/
+	LatencyHistogram* timer(Stage stage)
+	{
+		return m_Enabled ? &m_Stages[stage] : NULL;
+	}
+
+	/**
+	* Histogram of one bot, NULL while disabled.
+	*/
+	LatencyHistogram* botTimer(size_t bot)
+	{
+		return m_Enabled && bot < m_Bots.size() ? &m_Bots[bot] : NULL;
+	}
+
+	/**
+	* Sets up one histogram per bot. Must not be called while bots are timed.
+	*/
+	void setBotName(size_t bot, const string& name)
+	{
+		if (bot >= m_Bots.size())
+		{
+			m_Bots.resize(bot + 1);
+			m_BotNames.resize(bot + 1);
+		}
+		m_BotNames[bot] = name;
+	}
+
+	void count(Counter counter, boost::uint64_t amount = 1)
+	{
+		if (m_Enabled)
+		{
+			m_Counters[counter] += amount;
+		}
+	}
+
+	const LatencyHistogram& getStage(Stage stage) const { return m_Stages[stage]; }
+	const LatencyHistogram& getBot(size_t bot) const { return m_Bots[bot]; }
+	boost::uint64_t getCounter(Counter counter) const { return m_Counters[counter]; }
+
+	/**
+	* Writes a table of all stages, bots and counters, times in microseconds.
+	* The decision making stage is the sum of all bots. The format of the stream is left as it was.
+	*/
+	void dump(ostream& out) const
+	{
+		ios::fmtflags flags = out.flags();
+		streamsize precision = out.precision();
+		LatencyHistogram cdms = m_Stages[STAGE_CDMS];
+		for (auto iter = m_Bots.begin(); iter != m_Bots.end(); ++iter)
+		{
+			cdms.merge(*iter);
+		}
+
+		out << left << setw(16) << "stage" << right << setw(10) << "count"
+			<< setw(10) << "mean" << setw(10) << "p50" << setw(10) << "p99" << setw(10) << "max" << endl;
+
+		static const char* stageNames[STAGE_COUNT] = { "commander", "planer", "cdms", "flush" };
+		for (int i = 0; i < STAGE_COUNT; ++i)
+		{
+			dumpRow(out, stageNames[i], i == STAGE_CDMS ? cdms : m_Stages[i]);
+		}
+		for (size_t i = 0; i < m_Bots.size(); ++i)
+		{
+			if (m_Bots[i].getCount() > 0)
+			{
+				dumpRow(out, "  " + m_BotNames[i], m_Bots[i]);
+			}
+		}
+
+		static const char* counterNames[COUNTER_COUNT] = { "ticks", "commands", "bytes", "suppressed" };
+		for (int i = 0; i < COUNTER_COUNT; ++i)
+		{
+			out << left << setw(16) << counterNames[i] << right << setw(10) << m_Counters[i] << endl;
+		}
+		out.flags(flags);
+		out.precision(precision);
+	}
+
+private:
+	bool m_Enabled;
+	vector<LatencyHistogram> m_Stages;
+	vector<LatencyHistogram> m_Bots;
+	vector<string> m_BotNames;
+	vector<boost::uint64_t> m_Counters;
+
+	static void dumpRow(ostream& out, const string& name, const LatencyHistogram& histogram)
+	{
+		out << left << setw(16) << name << right << setw(10) << histogram.getCount() << fixed << setprecision(1)
+			<< setw(10) << histogram.getMean() / 1000.0
+			<< setw(10) << histogram.getPercentile(0.5) / 1000.0
+			<< setw(10) << histogram.getPercentile(0.99) / 1000.0
+			<< setw(10) << histogram.getMax() / 1000.0 << endl;
+	}
+};
+
+#endif // INSTRUMENTATION_H
@@ -0,0 +1,111 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <string>
+#include <boost/cstdint.hpp>
+
+using namespace std;
+
+/**
+* Seedable pseudo-random stream (xoshiro256**).
+* Every instance has its own state, so streams can be used from different threads
+* and a given seed always reproduces the same sequence on every platform.
+*/
+class Random
+{
+public:
+	explicit Random(boost::uint64_t seed = 0)
+	{
+		this->seed(seed);
+	}
+
+	/**
+	* Creates one of many independent streams derived from the same seed,
+	* e.g. one stream per bot from a match seed.
+	*/
+	Random(boost::uint64_t seed, boost::uint64_t stream)
+	{
+		boost::uint64_t mixer = stream;
+		this->seed(seed ^ splitMix(mixer));
+	}
+
+	void seed(boost::uint64_t seed)
+	{
+		// Expand the seed with SplitMix64, as recommended for xoshiro
+		for (int i = 0; i < 4; ++i)
+		{
+			m_State[i] = splitMix(seed);
+		}
+	}
+
+	boost::uint64_t next()
+	{
+		const boost::uint64_t result = rotl(m_State[1] * 5, 7) * 9;
+		const boost::uint64_t t = m_State[1] << 17;
+
+		m_State[2] ^= m_State[0];
+		m_State[3] ^= m_State[1];
+		m_State[1] ^= m_State[2];
+		m_State[0] ^= m_State[3];
+		m_State[2] ^= t;
+		m_State[3] = rotl(m_State[3], 45);
+
+		return result;
+	}
+
+	/**
+	* Uniform float in [0, 1).
+	*/
+	float nextFloat()
+	{
+		return (next() >> 40) * (1.0f / 16777216.0f);
+	}
+
+	/**
+	* Uniform integer in [0, bound).
+	*/
+	unsigned nextInt(unsigned bound)
+	{
+		return (unsigned)(((next() >> 32) * bound) >> 32);
+	}
+
+	bool nextBool()
+	{
+		return (next() >> 63) != 0;
+	}
+
+	/**
+	* Stable 64-bit hash of a name (FNV-1a), to derive a stream from e.g. a bot name.
+	*/
+	static boost::uint64_t hash(const string& name)
+	{
+		boost::uint64_t h = 14695981039346656037ULL;
+		for (auto iter = name.begin(); iter != name.end(); ++iter)
+		{
+			h ^= (unsigned char)*iter;
+			h *= 1099511628211ULL;
+		}
+		return h;
+	}
+
+private:
+	boost::uint64_t m_State[4];
+
+	static boost::uint64_t rotl(boost::uint64_t x, int k)
+	{
+		return (x << k) | (x >> (64 - k));
+	}
+
+	static boost::uint64_t splitMix(boost::uint64_t& state)
+	{
+		boost::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+};
+
+#endif // RANDOM_H
@@ -0,0 +1,103 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <vector>
+#include <cstddef>
+
+using namespace std;
+
+/**
+* Double ended queue on top of a single power-of-two sized array.
+* Only grows when it is full, so a queue that was reserved once never allocates again.
+*/
+template <typename T>
+class RingBuffer
+{
+public:
+	RingBuffer()
+		: m_Head(0), m_Size(0) {}
+
+	/**
+	* Makes sure at least the given number of elements fit without growing.
+	*/
+	void reserve(size_t capacity)
+	{
+		if (capacity > m_Data.size())
+		{
+			grow(capacity);
+		}
+	}
+
+	void push_front(const T& value)
+	{
+		if (m_Size == m_Data.size())
+		{
+			grow(m_Size + 1);
+		}
+		m_Head = (m_Head - 1) & mask();
+		m_Data[m_Head] = value;
+		++m_Size;
+	}
+
+	void push_back(const T& value)
+	{
+		if (m_Size == m_Data.size())
+		{
+			grow(m_Size + 1);
+		}
+		m_Data[(m_Head + m_Size) & mask()] = value;
+		++m_Size;
+	}
+
+	void pop_front()
+	{
+		m_Head = (m_Head + 1) & mask();
+		--m_Size;
+	}
+
+	T& front() { return m_Data[m_Head]; }
+	const T& front() const { return m_Data[m_Head]; }
+
+	T& operator[](size_t i) { return m_Data[(m_Head + i) & mask()]; }
+	const T& operator[](size_t i) const { return m_Data[(m_Head + i) & mask()]; }
+
+	size_t size() const { return m_Size; }
+	size_t capacity() const { return m_Data.size(); }
+	bool empty() const { return m_Size == 0; }
+
+	void clear()
+	{
+		m_Head = 0;
+		m_Size = 0;
+	}
+
+private:
+	vector<T> m_Data;
+	size_t m_Head;
+	size_t m_Size;
+
+	size_t mask() const { return m_Data.size() - 1; }
+
+	void grow(size_t minCapacity)
+	{
+		size_t capacity = m_Data.empty() ? 16 : m_Data.size();
+		while (capacity < minCapacity)
+		{
+			capacity *= 2;
+		}
+
+		// Unwrap the elements so that the head starts at zero again
+		vector<T> data(capacity);
+		for (size_t i = 0; i < m_Size; ++i)
+		{
+			data[i] = (*this)[i];
+		}
+		m_Data.swap(data);
+		m_Head = 0;
+	}
+};
+
+#endif // RING_BUFFER_H
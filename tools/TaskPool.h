@@ -0,0 +1,206 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+#if _MSC_VER > 1000
+#pragma once
+#endif // _MSC_VER > 1000
+
+#include <vector>
+#include <memory>
+#include <boost/thread.hpp>
+#include <boost/atomic.hpp>
+#include "Delegate.h"
+
+using namespace std;
+
+/**
+* Pool of worker threads that runs indexed tasks with work stealing.
+* Every call to run() splits the task indices evenly over all threads (the calling one included).
+* A thread that ran out of work steals the back half of the range of another thread.
+*
+* A pool of one thread runs everything inline on the calling thread.
+*/
+class TaskPool
+{
+public:
+	typedef Delegate<void (size_t)> Task;
+
+	explicit TaskPool(unsigned threads)
+		: m_Ranges(threads > 0 ? threads : 1), m_Generation(0), m_Busy(0), m_Stop(false), m_Remaining(0)
+	{
+		for (size_t i = 0; i < m_Ranges.size(); ++i)
+		{
+			m_Ranges[i].reset(new Range());
+		}
+		// The calling thread is worker 0
+		for (unsigned i = 1; i < m_Ranges.size(); ++i)
+		{
+			m_Workers.push_back(unique_ptr<boost::thread>(new boost::thread(&TaskPool::workerLoop, this, i)));
+		}
+	}
+
+	~TaskPool()
+	{
+		{
+			boost::lock_guard<boost::mutex> lock(m_Mutex);
+			m_Stop = true;
+		}
+		m_WakeUp.notify_all();
+		for (auto iter = m_Workers.begin(); iter != m_Workers.end(); ++iter)
+		{
+			(*iter)->join();
+		}
+	}
+
+	unsigned getThreadCount() const { return m_Ranges.size(); }
+
+	/**
+	* Runs the task for every index in [0, count) and returns once all of them are done.
+	*/
+	void run(size_t count, const Task& task)
+	{
+		if (m_Workers.empty())
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				task(i);
+			}
+			return;
+		}
+
+		{
+			boost::lock_guard<boost::mutex> lock(m_Mutex);
+			m_Task = task;
+			m_Remaining = count;
+
+			size_t threads = m_Ranges.size();
+			for (size_t i = 0; i < threads; ++i)
+			{
+				boost::lock_guard<boost::mutex> rangeLock(m_Ranges[i]->m_Lock);
+				m_Ranges[i]->m_Begin = count * i / threads;
+				m_Ranges[i]->m_End = count * (i + 1) / threads;
+			}
+			++m_Generation;
+		}
+		m_WakeUp.notify_all();
+
+		work(0);
+
+		boost::unique_lock<boost::mutex> lock(m_Mutex);
+		while (m_Remaining != 0 || m_Busy != 0)
+		{
+			m_Done.wait(lock);
+		}
+	}
+
+private:
+	/**
+	* Task indices [m_Begin, m_End) still owned by one thread.
+	*/
+	struct Range
+	{
+		boost::mutex m_Lock;
+		size_t m_Begin;
+		size_t m_End;
+
+		Range() : m_Begin(0), m_End(0) {}
+	};
+
+	vector<unique_ptr<Range> > m_Ranges;
+	vector<unique_ptr<boost::thread> > m_Workers;
+
+	boost::mutex m_Mutex;
+	boost::condition_variable m_WakeUp;
+	boost::condition_variable m_Done;
+	unsigned m_Generation;
+	unsigned m_Busy;
+	bool m_Stop;
+
+	Task m_Task;
+	boost::atomic<size_t> m_Remaining;
+
+	void workerLoop(unsigned self)
+	{
+		unsigned seen = 0;
+		while (true)
+		{
+			{
+				boost::unique_lock<boost::mutex> lock(m_Mutex);
+				while (m_Generation == seen && !m_Stop)
+				{
+					m_WakeUp.wait(lock);
+				}
+				if (m_Stop)
+				{
+					return;
+				}
+				seen = m_Generation;
+				++m_Busy;
+			}
+
+			work(self);
+
+			boost::lock_guard<boost::mutex> lock(m_Mutex);
+			if (--m_Busy == 0 && m_Remaining == 0)
+			{
+				m_Done.notify_all();
+			}
+		}
+	}
+
+	void work(unsigned self)
+	{
+		size_t task;
+		while (takeTask(self, task) || stealTask(self, task))
+		{
+			m_Task(task);
+			if (--m_Remaining == 0)
+			{
+				boost::lock_guard<boost::mutex> lock(m_Mutex);
+				m_Done.notify_all();
+			}
+		}
+	}
+
+	bool takeTask(unsigned self, size_t& task)
+	{
+		Range& range = *m_Ranges[self];
+		boost::lock_guard<boost::mutex> lock(range.m_Lock);
+		if (range.m_Begin == range.m_End)
+		{
+			return false;
+		}
+		task = range.m_Begin++;
+		return true;
+	}
+
+	bool stealTask(unsigned self, size_t& task)
+	{
+		size_t threads = m_Ranges.size();
+		for (size_t i = 1; i < threads; ++i)
+		{
+			Range& victim = *m_Ranges[(self + i) % threads];
+			size_t begin, end;
+			{
+				boost::lock_guard<boost::mutex> lock(victim.m_Lock);
+				size_t left = victim.m_End - victim.m_Begin;
+				if (left == 0)
+				{
+					continue;
+				}
+				end = victim.m_End;
+				begin = end - (left + 1) / 2;
+				victim.m_End = begin;
+			}
+
+			Range& range = *m_Ranges[self];
+			boost::lock_guard<boost::mutex> lock(range.m_Lock);
+			range.m_Begin = begin + 1;
+			range.m_End = end;
+			task = begin;
+			return true;
+		}
+		return false;
+	}
+};
+
+#endif // TASK_POOL_H